@@ -1,15 +1,372 @@
 #include "lsignal.h"
 
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
 namespace lsignal
 {
-	connection_data::connection_data()
+	static std::atomic<std::ptrdiff_t> memory_counters[4];
+
+	size_t memory_usage_info::total() const
+	{
+		return callbacks + connections + storage + cleaners;
+	}
+
+	memory_usage_info& memory_usage_info::operator+= (const memory_usage_info& rhs)
+	{
+		callbacks += rhs.callbacks;
+		connections += rhs.connections;
+		storage += rhs.storage;
+		cleaners += rhs.cleaners;
+		dead_entries += rhs.dead_entries;
+		dead_bytes += rhs.dead_bytes;
+		return *this;
+	}
+
+	void count_memory(memory_kind kind, std::ptrdiff_t bytes)
+	{
+		if (bytes != 0)
+			memory_counters[(int)kind].fetch_add(bytes, std::memory_order_relaxed);
+	}
+
+	memory_usage_info global_memory_usage()
+	{
+		memory_usage_info usage;
+		usage.callbacks = (size_t)memory_counters[(int)memory_kind::callbacks].load(std::memory_order_relaxed);
+		usage.connections = (size_t)memory_counters[(int)memory_kind::connections].load(std::memory_order_relaxed);
+		usage.storage = (size_t)memory_counters[(int)memory_kind::storage].load(std::memory_order_relaxed);
+		usage.cleaners = (size_t)memory_counters[(int)memory_kind::cleaners].load(std::memory_order_relaxed);
+		return usage;
+	}
+
+	signal_data_base::~signal_data_base()
+	{
+	}
+
+	void signal_data_base::compact()
+	{
+		write_lock locker(this);
+		delete_deffered(0);
+	}
+
+	void signal_data_base::try_compact(int ending_calls)
+	{
+		write_lock locker(this, std::try_to_lock);
+		if (locker.owns_lock())
+			delete_deffered(ending_calls);
+	}
+
+	signal_data_base::write_lock::write_lock(signal_data_base* data)
+		: _data(data)
+		, _owns(false)
+	{
+		lock();
+	}
+
+	signal_data_base::write_lock::write_lock(signal_data_base* data, std::defer_lock_t)
+		: _data(data)
+		, _owns(false)
+	{
+	}
+
+	signal_data_base::write_lock::write_lock(signal_data_base* data, std::try_to_lock_t)
+		: _data(data)
+		, _owns(false)
+	{
+		try_lock();
+	}
+
+	signal_data_base::write_lock::~write_lock()
+	{
+		if (_owns)
+			unlock();
+	}
+
+	void signal_data_base::write_lock::lock()
+	{
+		_data->_mutex.lock();
+		_owns = true;
+	}
+
+	bool signal_data_base::write_lock::try_lock()
+	{
+		_owns = _data->_mutex.try_lock();
+		return _owns;
+	}
+
+	void signal_data_base::write_lock::unlock()
+	{
+		//one thread destroys freed joints, others leave new ones retired until it ends
+		const bool destroy = _data->_has_freed && !_data->_destroying_freed.load(std::memory_order_relaxed);
+		if (destroy)
+		{
+			_data->_has_freed = false;
+			_data->_destroying_freed.store(true, std::memory_order_relaxed);
+		}
+
+		_owns = false;
+		_data->_mutex.unlock();
+
+		if (destroy)
+		{
+			_data->destroy_freed();
+			_data->_destroying_freed.store(false, std::memory_order_release);
+		}
+	}
+
+	int signal_data_base::calls_in_progress() const
+	{
+		const uint64_t calls = _calls.load() & ~released_bit;
+		return (int)(calls & 0xFFFFFFFF) + (int)(calls >> 32);
+	}
+
+	void signal_data_base::wait_calls()
+	{
+		//calls of this signal on stack of current thread by parity of epoch
+		int own_calls[2] = { 0, 0 };
+		for (const call_frame* frame = current_call_frame; frame != nullptr; frame = frame->prev)
+		{
+			for (size_t i = 0; i < frame->depth; i++)
+			{
+				if (frame->chain[i] == this)
+					own_calls[frame->epochs[i]]++;
+			}
+		}
+
+		//seq_cst loads after seq_cst store of deleted by caller, pair with seq_cst increment of
+		//_calls and load of deleted by signal call: call not seen here sees connection deleted.
+		const auto calls_of = [this](unsigned parity)
+		{
+			return (int)((_calls.load() & ~released_bit) >> (32 * parity) & 0xFFFFFFFF);
+		};
+
+		//Epoch is flipped when calls of previous epoch are drained, they started before this wait too.
+		//Spin lock is held only for check and flip, so wait from callback don't wait for other waiter.
+		unsigned old_epoch;
+		for (;;)
+		{
+			while (_waiting.exchange(true, std::memory_order_acquire))
+				std::this_thread::yield();
+
+			old_epoch = _call_epoch.load() & 1;
+			const bool flip = calls_of(old_epoch ^ 1) <= own_calls[old_epoch ^ 1];
+
+			//calls started after this see connections deleted before
+			if (flip)
+				_call_epoch.fetch_add(1);
+
+			_waiting.store(false, std::memory_order_release);
+			if (flip)
+				break;
+
+			std::this_thread::yield();
+		}
+
+		//Later waiter can flip epoch back to old parity, then calls started after it are waited too.
+		while (calls_of(old_epoch) > own_calls[old_epoch])
+			std::this_thread::yield();
+	}
+
+	std::mutex& forward_graph_mutex()
+	{
+		static std::mutex mutex;
+		return mutex;
+	}
+
+	std::mutex& connection_copies_mutex()
+	{
+		static std::mutex mutex;
+		return mutex;
+	}
+
+	//Wait calls of all signals once, signals are sorted.
+	static void wait_signals(std::pmr::vector<std::shared_ptr<signal_data_base>>& signals)
 	{
+		std::sort(signals.begin(), signals.end());
+		signals.erase(std::unique(signals.begin(), signals.end()), signals.end());
 
+		for (const std::shared_ptr<signal_data_base>& signal_data : signals)
+			signal_data->wait_calls();
+	}
+
+	const size_t connection_data::allocated_size = sizeof(connection_data) + shared_block_overhead;
+
+	connection_data::connection_data()
+	{
+		count_memory(memory_kind::connections, allocated_size);
 	}
 
 	connection_data::~connection_data()
 	{
+		if (copies != nullptr)
+		{
+			std::pmr::polymorphic_allocator<copy_list> allocator(resource);
+			copies->~copy_list();
+			allocator.deallocate(copies, 1);
+		}
+
+		count_memory(memory_kind::connections, -(std::ptrdiff_t)allocated_size);
+	}
+
+	uint64_t profile_ticks()
+	{
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+		return __rdtsc();
+#else
+		return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+	}
+
+	//Steady clock and ticks when profiler was enabled first time, tick rate is measured since it.
+	struct tick_calibration
+	{
+		std::chrono::steady_clock::time_point time;
+		uint64_t ticks;
+	};
+
+	static const tick_calibration& calibration_start()
+	{
+		static const tick_calibration start{ std::chrono::steady_clock::now(), profile_ticks() };
+		return start;
+	}
+
+	void profiler::set_sampling_period(uint32_t period)
+	{
+		//start calibration of ticks, measured by top()
+		if (period != 0)
+			calibration_start();
+
+		_period.store(period, std::memory_order_relaxed);
+	}
+
+	uint32_t profiler::sampling_period()
+	{
+		return _period.load(std::memory_order_relaxed);
+	}
+
+	//Records by label, guarded by profile_mutex().
+	static std::vector<std::unique_ptr<profile_record>>& profile_records()
+	{
+		static std::vector<std::unique_ptr<profile_record>> records;
+		return records;
+	}
+
+	static std::mutex& profile_mutex()
+	{
+		static std::mutex mutex;
+		return mutex;
+	}
+
+	std::vector<profile_entry> profiler::top(size_t count)
+	{
+		const double ticks_per_ns = ticks_per_nanosecond();
+		std::vector<profile_entry> entries;
+		{
+			std::lock_guard<std::mutex> locker(profile_mutex());
+			for (const std::unique_ptr<profile_record>& record : profile_records())
+			{
+				profile_entry entry;
+				entry.samples = record->samples.load(std::memory_order_relaxed);
+				entry.nanoseconds = (uint64_t)(record->ticks.load(std::memory_order_relaxed) / ticks_per_ns);
+				if (entry.samples == 0)
+					continue;
+
+				entry.label = record->label;
+				entries.push_back(std::move(entry));
+			}
+		}
+
+		std::sort(entries.begin(), entries.end(),
+			[](const profile_entry& lhs, const profile_entry& rhs) { return lhs.nanoseconds > rhs.nanoseconds; });
+
+		if (entries.size() > count)
+			entries.resize(count);
+
+		return entries;
+	}
+
+	void profiler::reset()
+	{
+		std::lock_guard<std::mutex> locker(profile_mutex());
+		for (const std::unique_ptr<profile_record>& record : profile_records())
+		{
+			record->samples.store(0, std::memory_order_relaxed);
+			record->ticks.store(0, std::memory_order_relaxed);
+		}
+	}
+
+	double profiler::ticks_per_nanosecond()
+	{
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+		using clock = std::chrono::steady_clock;
+		const tick_calibration& start = calibration_start();
+
+		//short interval is extended, longer one is more precise
+		const clock::duration min_interval = std::chrono::milliseconds(10);
+		clock::duration elapsed = clock::now() - start.time;
+		if (elapsed < min_interval)
+		{
+			std::this_thread::sleep_for(min_interval - elapsed);
+			elapsed = clock::now() - start.time;
+		}
+
+		const uint64_t ticks = profile_ticks() - start.ticks;
+		return ticks / (double)std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+#else
+		return 1.0;
+#endif
+	}
+
+	profile_record* profiler::find_record(const char* label)
+	{
+		std::lock_guard<std::mutex> locker(profile_mutex());
+		std::vector<std::unique_ptr<profile_record>>& records = profile_records();
+
+		for (const std::unique_ptr<profile_record>& record : records)
+		{
+			if (record->label == label)
+				return record.get();
+		}
+
+		records.emplace_back(new profile_record());
+		records.back()->label = label;
+		return records.back().get();
+	}
+
+	void connection_data::add_copy(const std::shared_ptr<signal_data_base>& copy)
+	{
+		if (copies == nullptr)
+		{
+			std::pmr::polymorphic_allocator<copy_list> allocator(resource);
+			copies = allocator.allocate(1);
+			new (copies) copy_list(resource);
+		}
+
+		copies->erase(std::remove_if(copies->begin(), copies->end(),
+			[](const std::weak_ptr<signal_data_base>& ptr) { return ptr.expired(); }), copies->end());
+		copies->push_back(copy);
+	}
 
+	void connection_data::get_signals(std::pmr::vector<std::shared_ptr<signal_data_base>>& signals) const
+	{
+		//signal destroyed in callback is held by that call
+		if (std::shared_ptr<signal_data_base> data = signal_data.lock())
+			signals.push_back(std::move(data));
+
+		std::lock_guard<std::mutex> locker(connection_copies_mutex());
+		if (copies == nullptr)
+			return;
+
+		for (const std::weak_ptr<signal_data_base>& copy : *copies)
+		{
+			if (std::shared_ptr<signal_data_base> data = copy.lock())
+				signals.push_back(std::move(data));
+		}
 	}
 
 	connection_cleaner::connection_cleaner()
@@ -44,6 +401,9 @@ namespace lsignal
 	void connection::set_lock(const bool lock)
 	{
 		_data->locked = lock;
+
+		if (std::shared_ptr<signal_data_base> signal_data = _data->signal_data.lock())
+			signal_data->update_active(_data.get());
 	}
 
 	void connection::disconnect()
@@ -52,29 +412,1432 @@ namespace lsignal
 		{
 			//connection fully cleared after next signal call or signal delete
 			_data->deleted = true;
+
+			if (std::shared_ptr<signal_data_base> signal_data = _data->signal_data.lock())
+				signal_data->update_active(_data.get());
+
 			_data.reset();
 		}
 	}
 
+	void connection::disconnect_and_wait()
+	{
+		if (!_data)
+			return;
+
+		//copies made after disconnect see it deleted
+		std::shared_ptr<connection_data> data = _data;
+		disconnect();
+
+		std::pmr::vector<std::shared_ptr<signal_data_base>> signals;
+		data->get_signals(signals);
+		wait_signals(signals);
+	}
+
+	const char* connection::label() const
+	{
+		return _data && _data->profile ? _data->profile->label.c_str() : nullptr;
+	}
+
+	//Order of signals, by control block of signal data, stays after signal is destroyed.
+	struct cleaner_order
+	{
+		bool operator() (const connection_cleaner& lhs, const std::shared_ptr<signal_data_base>& rhs) const
+		{
+			return lhs.data->signal_data.owner_before(rhs);
+		}
+
+		bool operator() (const std::shared_ptr<signal_data_base>& lhs, const connection_cleaner& rhs) const
+		{
+			return lhs.owner_before(rhs.data->signal_data);
+		}
+
+		bool operator() (const connection_cleaner& lhs, const std::weak_ptr<signal_data_base>& rhs) const
+		{
+			return lhs.data->signal_data.owner_before(rhs);
+		}
+
+		bool operator() (const std::weak_ptr<signal_data_base>& lhs, const connection_cleaner& rhs) const
+		{
+			return lhs.owner_before(rhs.data->signal_data);
+		}
+
+		bool operator() (const connection_cleaner& lhs, const connection_cleaner& rhs) const
+		{
+			return lhs.data->signal_data.owner_before(rhs.data->signal_data);
+		}
+	};
+
+	cleaner_map::cleaner_map(std::pmr::memory_resource* resource)
+		: _items(reinterpret_cast<connection_cleaner*>(_inline))
+		, _resource(resource)
+	{
+	}
+
+	cleaner_map::cleaner_map(cleaner_map&& rhs)
+		: _items(reinterpret_cast<connection_cleaner*>(_inline))
+		, _resource(rhs._resource)
+	{
+		if (rhs.is_inline())
+		{
+			for (uint32_t i = 0; i < rhs._size; i++)
+			{
+				new (&_items[i]) connection_cleaner(std::move(rhs._items[i]));
+				rhs._items[i].~connection_cleaner();
+			}
+		} else
+		{
+			_items = rhs._items;
+			_capacity = rhs._capacity;
+			rhs._items = reinterpret_cast<connection_cleaner*>(rhs._inline);
+			rhs._capacity = inline_capacity;
+		}
+
+		_size = rhs._size;
+		_grouped = rhs._grouped;
+		rhs._size = 0;
+		rhs._grouped = 0;
+	}
+
+	cleaner_map::~cleaner_map()
+	{
+		erase(begin(), end());
+		if (!is_inline())
+			_resource->deallocate(_items, _capacity * sizeof(connection_cleaner), alignof(connection_cleaner));
+	}
+
+	size_t cleaner_map::bytes() const
+	{
+		return (is_inline() ? _size : _capacity) * sizeof(connection_cleaner);
+	}
+
+	std::pair<connection_cleaner*, connection_cleaner*> cleaner_map::equal_range(const std::shared_ptr<signal_data_base>& signal_data) const
+	{
+		group();
+		return std::equal_range(_items, _items + _size, signal_data, cleaner_order());
+	}
+
+	void cleaner_map::insert(const std::shared_ptr<connection_data>& connection)
+	{
+		if (_size == _capacity)
+			grow();
+
+		new (end()) connection_cleaner();
+		end()->data = connection;
+		_size++;
+	}
+
+	void cleaner_map::erase(connection_cleaner* first, connection_cleaner* last)
+	{
+		//grouped prefix before erased range stays grouped
+		const uint32_t removed = (uint32_t)(last - first);
+		if (last <= _items + _grouped)
+			_grouped -= removed;
+		else
+			_grouped = std::min(_grouped, (uint32_t)(first - _items));
+
+		connection_cleaner* tail = std::move(last, end(), first);
+		for (connection_cleaner* it = tail; it != end(); ++it)
+			it->~connection_cleaner();
+
+		_size = (uint32_t)(tail - _items);
+	}
+
+	void cleaner_map::group() const
+	{
+		if (_grouped == _size)
+			return;
+
+		//stable, connections of one signal keep connect order
+		connection_cleaner* middle = _items + _grouped;
+		std::stable_sort(middle, _items + _size, cleaner_order());
+		std::inplace_merge(_items, middle, _items + _size, cleaner_order());
+		_grouped = _size;
+	}
+
+	void cleaner_map::grow()
+	{
+		uint32_t capacity = _capacity * 2;
+		connection_cleaner* items = static_cast<connection_cleaner*>(_resource->allocate(capacity * sizeof(connection_cleaner), alignof(connection_cleaner)));
+
+		for (uint32_t i = 0; i < _size; i++)
+		{
+			new (&items[i]) connection_cleaner(std::move(_items[i]));
+			_items[i].~connection_cleaner();
+		}
+
+		if (!is_inline())
+			_resource->deallocate(_items, _capacity * sizeof(connection_cleaner), alignof(connection_cleaner));
+
+		_items = items;
+		_capacity = capacity;
+	}
+
 	slot::slot()
+		: _cleaners(std::pmr::get_default_resource())
+	{
+	}
+
+	slot::slot(std::pmr::memory_resource* resource)
+		: _cleaners(resource)
 	{
 	}
 
+	slot::slot(const slot& rhs)
+		: _cleaners(rhs._cleaners.resource())
+		, _compact_signals(rhs._compact_signals)
+	{
+	}
+
+	slot& slot::operator= (const slot& rhs)
+	{
+		_compact_signals = rhs._compact_signals;
+		return *this;
+	}
+
 	slot::~slot()
 	{
 		disconnect();
 	}
 
+	//Resume awaiters of next(owner) with std::nullopt. Called last, resumed coroutine can destroy the slot.
+	static void cancel_awaiter(connection_data* cleaner)
+	{
+#ifdef LSIGNAL_COROUTINES
+		signal_storage::cancel_awaiter(static_cast<awaiter_cleaner*>(cleaner));
+#else
+		(void)cleaner;
+#endif
+	}
+
 	void slot::disconnect()
 	{
-		decltype(_cleaners) cleaners = _cleaners;
+		disconnect_cleaners(false);
+	}
 
-		for (auto iter = cleaners.cbegin(); iter != cleaners.cend(); ++iter)
-		{
-			const connection_cleaner& cleaner = *iter;
+	void slot::disconnect_and_wait()
+	{
+		disconnect_cleaners(true);
+	}
+
+	void slot::disconnect_cleaners(const bool wait)
+	{
+		//Move, not copy: marking don't call user code, but compact can destroy callbacks,
+		//which can connect to this slot again.
+		count_memory(memory_kind::cleaners, -(std::ptrdiff_t)_cleaners.bytes());
+		cleaner_map cleaners(std::move(_cleaners));
+
+		for (const connection_cleaner& cleaner : cleaners)
 			cleaner.data->deleted = true;
+
+		if (wait)
+		{
+			std::pmr::vector<std::shared_ptr<signal_data_base>> waited(_cleaners.resource());
+			for (const connection_cleaner& cleaner : cleaners)
+				cleaner.data->get_signals(waited);
+
+			wait_signals(waited);
+		}
+
+		if (_compact_signals)
+		{
+			//cleaners are not grouped, consecutive connections to one signal are skipped, others by unique
+			std::pmr::vector<std::shared_ptr<signal_data_base>> signals(_cleaners.resource());
+
+			for (const connection_cleaner& cleaner : cleaners)
+			{
+				std::shared_ptr<signal_data_base> signal_data = cleaner.data->signal_data.lock();
+				if (signal_data && (signals.empty() || signals.back() != signal_data))
+					signals.push_back(std::move(signal_data));
+			}
+
+			std::sort(signals.begin(), signals.end());
+			signals.erase(std::unique(signals.begin(), signals.end()), signals.end());
+
+			for (const std::shared_ptr<signal_data_base>& signal_data : signals)
+				signal_data->compact();
+		}
+
+		for (const connection_cleaner& cleaner : cleaners)
+		{
+			if (cleaner.data->awaiter)
+				cancel_awaiter(cleaner.data.get());
 		}
+	}
 
-		_cleaners.clear();
+	void slot::add_cleaner(const std::shared_ptr<connection_data>& connection)
+	{
+		const size_t bytes = _cleaners.bytes();
+		_cleaners.insert(connection);
+		count_memory(memory_kind::cleaners, (std::ptrdiff_t)(_cleaners.bytes() - bytes));
 	}
-}//namespace lsignal
\ No newline at end of file
+
+	void slot::disconnect_signal(const std::shared_ptr<signal_data_base>& signal_data)
+	{
+		std::pair<connection_cleaner*, connection_cleaner*> range = _cleaners.equal_range(signal_data);
+		if (range.first == range.second)
+			return;
+
+		//Connections are released after cleaners are erased, callbacks destroyed by it can use this slot.
+		std::pmr::vector<std::shared_ptr<connection_data>> removed(_cleaners.resource());
+		removed.reserve(range.second - range.first);
+		for (connection_cleaner* it = range.first; it != range.second; ++it)
+		{
+			it->data->deleted = true;
+			removed.push_back(std::move(it->data));
+		}
+
+		const size_t bytes = _cleaners.bytes();
+		_cleaners.erase(range.first, range.second);
+		count_memory(memory_kind::cleaners, (std::ptrdiff_t)_cleaners.bytes() - (std::ptrdiff_t)bytes);
+
+		if (_compact_signals)
+			signal_data->compact();
+
+		for (const std::shared_ptr<connection_data>& connection : removed)
+		{
+			if (connection->awaiter)
+				cancel_awaiter(connection.get());
+		}
+	}
+
+	size_t slot::count_connections(const std::shared_ptr<signal_data_base>& signal_data) const
+	{
+		std::pair<const connection_cleaner*, const connection_cleaner*> range = _cleaners.equal_range(signal_data);
+
+		return (size_t)std::count_if(range.first, range.second,
+			[](const connection_cleaner& cleaner) { return !cleaner.data->deleted; });
+	}
+
+	size_t slot::connection_count() const
+	{
+		return (size_t)std::count_if(_cleaners.begin(), _cleaners.end(),
+			[](const connection_cleaner& cleaner) { return !cleaner.data->deleted; });
+	}
+
+	size_t slot::signal_count() const
+	{
+		_cleaners.group();
+
+		size_t count = 0;
+		const connection_cleaner* group = nullptr;
+		for (const connection_cleaner& cleaner : _cleaners)
+		{
+			if (cleaner.data->deleted)
+				continue;
+
+			if (group == nullptr || group->data->signal_data.owner_before(cleaner.data->signal_data))
+				count++;
+			group = &cleaner;
+		}
+
+		return count;
+	}
+
+	std::vector<connection> slot::connections() const
+	{
+		_cleaners.group();
+
+		std::vector<connection> result;
+		for (const connection_cleaner& cleaner : _cleaners)
+		{
+			if (!cleaner.data->deleted)
+				result.emplace_back(std::shared_ptr<connection_data>(cleaner.data));
+		}
+
+		return result;
+	}
+
+	memory_usage_info slot::memory_usage() const
+	{
+		memory_usage_info usage;
+		usage.cleaners = _cleaners.bytes();
+
+		for (const connection_cleaner& cleaner : _cleaners)
+		{
+			if (cleaner.data->deleted)
+			{
+				usage.dead_entries++;
+				usage.dead_bytes += sizeof(connection_cleaner);
+			}
+		}
+
+		return usage;
+	}
+
+	bool slot::is_compact_signals() const
+	{
+		return _compact_signals;
+	}
+
+	void slot::set_compact_signals(const bool compact)
+	{
+		_compact_signals = compact;
+	}
+
+	// signal storage
+
+	void joint_list::reserve(std::pmr::memory_resource* resource, size_t count)
+	{
+		if (count <= capacity)
+			return;
+
+		const size_t grown = std::max<size_t>(count, (size_t)capacity * 2);
+		joint_base** grown_items = static_cast<joint_base**>(resource->allocate(grown * sizeof(joint_base*), alignof(joint_base*)));
+		std::copy(items, items + size, grown_items);
+		release(resource);
+
+		items = grown_items;
+		capacity = (uint32_t)grown;
+	}
+
+	void joint_list::push_back(std::pmr::memory_resource* resource, joint_base* jnt)
+	{
+		reserve(resource, (size_t)size + 1);
+		items[size++] = jnt;
+	}
+
+	void joint_list::release(std::pmr::memory_resource* resource)
+	{
+		if (items != nullptr)
+			resource->deallocate(items, (size_t)capacity * sizeof(joint_base*), alignof(joint_base*));
+
+		items = nullptr;
+		capacity = 0;
+	}
+
+	//Visit main callbacks and arrays of all keyed buckets, guarded by _mutex.
+	template<typename Fn>
+	static void for_each_array(signal_storage* data, Fn&& fn)
+	{
+		fn(data->_callbacks);
+
+		if (key_index* keys = data->_keys.load(std::memory_order_relaxed))
+		{
+			for (size_t i = 0; i < keys->capacity; i++)
+			{
+				if (keys->buckets()[i].used.load(std::memory_order_relaxed))
+					fn(keys->buckets()[i].callbacks);
+			}
+		}
+	}
+
+	static joint_array* allocate_array(signal_storage* data, size_t capacity)
+	{
+		void* mem = data->_resource->allocate(joint_array::bytes(capacity), alignof(joint_array));
+		joint_array* callbacks = new (mem) joint_array();
+		callbacks->capacity = capacity;
+
+		std::atomic<joint_base*>* items = callbacks->items();
+		for (size_t i = 0; i < capacity; i++)
+			new (items + i) std::atomic<joint_base*>(nullptr);
+
+		std::atomic<uint64_t>* mask = callbacks->mask();
+		for (size_t i = 0; i < joint_array::mask_words(capacity); i++)
+			new (mask + i) std::atomic<uint64_t>(0);
+
+		return callbacks;
+	}
+
+	static void deallocate_array(signal_storage* data, joint_array* callbacks)
+	{
+		size_t bytes = joint_array::bytes(callbacks->capacity);
+		callbacks->~joint_array();
+		data->_resource->deallocate(callbacks, bytes, alignof(joint_array));
+	}
+
+	//Replace array in target (callbacks or key bucket), old one is retired.
+	static void publish_array(signal_storage* data, std::atomic<joint_array*>& target, joint_array* callbacks)
+	{
+		joint_array* old = target.exchange(callbacks);
+		if (old != nullptr)
+		{
+			old->retired_next = data->_retired_arrays;
+			data->_retired_arrays = old;
+		}
+	}
+
+	static void set_active(joint_array* callbacks, size_t index, bool active)
+	{
+		std::atomic<uint64_t>& word = callbacks->mask()[index / 64];
+		const uint64_t bit = uint64_t(1) << (index % 64);
+
+		if (active)
+			word.fetch_or(bit, std::memory_order_relaxed);
+		else
+			word.fetch_and(~bit, std::memory_order_relaxed);
+	}
+
+	//Set _single from main callbacks. Before retired joints are freed, so call which read
+	//old _single is counted.
+	static void update_single(signal_storage* data)
+	{
+		joint_array* callbacks = data->_callbacks.load(std::memory_order_relaxed);
+		joint_base* single = callbacks != nullptr && callbacks->size.load(std::memory_order_relaxed) == 1 ? callbacks->item(0) : nullptr;
+		if (data->_single.load(std::memory_order_relaxed) != single)
+			data->_single.store(single);
+	}
+
+	//Retired memory is freed if only ending calls are in progress.
+	static void free_retired(signal_storage* data, int ending_calls = 0)
+	{
+		update_single(data);
+
+		if (data->_retired_arrays != nullptr || data->_retired_indexes != nullptr || !data->_retired_joints.empty())
+		{
+			//Array is published before counter is checked, so call started after this check
+			//see only current array.
+			if (data->calls_in_progress() != ending_calls)
+			{
+				data->_maintenance_needed.store(true, std::memory_order_relaxed);
+			} else
+			{
+				while (joint_array* retired = data->_retired_arrays)
+				{
+					data->_retired_arrays = retired->retired_next;
+					deallocate_array(data, retired);
+				}
+
+				while (key_index* retired = data->_retired_indexes)
+				{
+					data->_retired_indexes = retired->retired_next;
+					data->_resource->deallocate(retired, key_index::bytes(retired->capacity), alignof(key_index));
+				}
+
+				//Joints are destroyed by write_lock after unlock. While other thread destroys
+				//previous ones, they wait for next compaction.
+				if (!data->_retired_joints.empty())
+				{
+					if (!data->_destroying_freed.load(std::memory_order_acquire) && data->_freed_joints.empty())
+					{
+						std::swap(data->_retired_joints, data->_freed_joints);
+						data->_has_freed = true;
+					} else
+						data->_maintenance_needed.store(true, std::memory_order_relaxed);
+				}
+			}
+		}
+
+		data->update_storage_count();
+		data->update_idle();
+	}
+
+	//Keyed arrays keep all mask bits set, their joints don't update connection index.
+	static void compact_array(signal_storage* data, std::atomic<joint_array*>& target, bool keyed)
+	{
+		joint_array* callbacks = target.load(std::memory_order_relaxed);
+		if (callbacks == nullptr)
+			return;
+
+		size_t count = callbacks->size.load(std::memory_order_relaxed);
+		size_t alive = 0;
+		for (size_t i = 0; i < count; i++)
+			alive += !callbacks->item(i)->connection->deleted;
+
+		if (alive == count)
+			return;
+
+		joint_array* compacted = alive > 0 ? allocate_array(data, alive) : nullptr;
+		size_t compacted_count = 0;
+
+		for (size_t i = 0; i < count; i++)
+		{
+			//connection can be deleted after counting, alive is upper bound
+			joint_base* jnt = callbacks->item(i);
+			if (compacted != nullptr && compacted_count < alive && !jnt->connection->deleted)
+			{
+				const bool primary = jnt->primary && !keyed;
+				if (primary)
+					jnt->connection->index = (uint32_t)compacted_count;
+
+				set_active(compacted, compacted_count, !primary || !jnt->connection->locked);
+				compacted->items()[compacted_count++].store(jnt, std::memory_order_relaxed);
+			} else
+				data->_retired_joints.push_back(data->_resource, jnt);
+		}
+
+		if (compacted != nullptr)
+			compacted->size.store(compacted_count, std::memory_order_relaxed);
+
+		publish_array(data, target, compacted);
+	}
+
+	//Copy on write: calls in progress keep reading old array.
+	static void compact_storage(signal_storage* data, int ending_calls = 0)
+	{
+		data->_maintenance_needed.store(false, std::memory_order_relaxed);
+
+		compact_array(data, data->_callbacks, false);
+
+		if (key_index* keys = data->_keys.load(std::memory_order_relaxed))
+		{
+			for (size_t i = 0; i < keys->capacity; i++)
+			{
+				if (keys->buckets()[i].used.load(std::memory_order_relaxed))
+					compact_array(data, keys->buckets()[i].callbacks, true);
+			}
+		}
+
+		free_retired(data, ending_calls);
+	}
+
+	static void push_callback(signal_storage* data, std::atomic<joint_array*>& target, joint_base* jnt)
+	{
+		joint_array* callbacks = target.load(std::memory_order_relaxed);
+		size_t count = callbacks ? callbacks->size.load(std::memory_order_relaxed) : 0;
+		jnt->connection->index = (uint32_t)count;
+
+		if (callbacks != nullptr && count < callbacks->capacity)
+		{
+			callbacks->items()[count].store(jnt, std::memory_order_relaxed);
+			set_active(callbacks, count, true);
+			callbacks->size.store(count + 1, std::memory_order_release);
+			return;
+		}
+
+		//Calls in progress hold old array, it is retired and freed when they end.
+		joint_array* grown = allocate_array(data, std::max<size_t>(4, count * 2));
+		if (count > 0)
+		{
+			for (size_t i = 0; i < count; i++)
+				grown->items()[i].store(callbacks->item(i), std::memory_order_relaxed);
+			for (size_t i = 0; i < joint_array::mask_words(count); i++)
+				grown->mask()[i].store(callbacks->mask()[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+		}
+
+		grown->items()[count].store(jnt, std::memory_order_relaxed);
+		set_active(grown, count, true);
+		grown->size.store(count + 1, std::memory_order_relaxed);
+
+		publish_array(data, target, grown);
+		free_retired(data);
+	}
+
+	//Exchange joint of the same connection with jnt in place, false if not found.
+	static bool exchange_joint(signal_storage* data, std::atomic<joint_array*>& target, joint_base* jnt)
+	{
+		joint_array* callbacks = target.load(std::memory_order_relaxed);
+		size_t count = callbacks ? callbacks->size.load(std::memory_order_relaxed) : 0;
+		if (count == 0)
+			return false;
+
+		//index is exact for main callbacks, keyed arrays are searched
+		const auto same = [jnt](const joint_base* old) { return old->primary && old->connection == jnt->connection; };
+		size_t index = jnt->connection->index;
+		if (index >= count || !same(callbacks->item(index)))
+		{
+			index = 0;
+			while (index < count && !same(callbacks->item(index)))
+				index++;
+		}
+
+		if (index == count || callbacks->item(index)->forward != nullptr)
+			return false;
+
+		//Call without lock may still visit old joint, it is retired and freed when calls end.
+		data->_retired_joints.reserve(data->_resource, data->_retired_joints.size + 1);
+		joint_base* old = callbacks->items()[index].exchange(jnt);
+		data->_retired_joints.push_back(data->_resource, old);
+
+		free_retired(data);
+		return true;
+	}
+
+	//Find or add bucket, table grows when half is used.
+	static std::atomic<joint_array*>& insert_keyed(signal_storage* data, uint64_t key)
+	{
+		key_index* keys = data->_keys.load(std::memory_order_relaxed);
+		if (keys != nullptr)
+		{
+			if (std::atomic<joint_array*>* found = signal_storage::find_keyed(keys, key))
+				return *found;
+		}
+
+		if (keys == nullptr || (keys->used + 1) * 2 > keys->capacity)
+		{
+			//Buckets of keys without connections are dropped.
+			size_t alive = 0;
+			for (size_t i = 0; keys != nullptr && i < keys->capacity; i++)
+				alive += keys->buckets()[i].callbacks.load(std::memory_order_relaxed) != nullptr;
+
+			size_t capacity = 8;
+			while (capacity < (alive + 1) * 4)
+				capacity *= 2;
+
+			void* mem = data->_resource->allocate(key_index::bytes(capacity), alignof(key_index));
+			key_index* grown = new (mem) key_index();
+			grown->capacity = capacity;
+			for (size_t i = 0; i < capacity; i++)
+				new (grown->buckets() + i) key_bucket();
+
+			for (size_t i = 0; keys != nullptr && i < keys->capacity; i++)
+			{
+				key_bucket& bucket = keys->buckets()[i];
+				if (joint_array* callbacks = bucket.callbacks.load(std::memory_order_relaxed))
+				{
+					size_t j = signal_storage::hash_key(bucket.key) & (capacity - 1);
+					while (grown->buckets()[j].used.load(std::memory_order_relaxed))
+						j = (j + 1) & (capacity - 1);
+
+					grown->buckets()[j].key = bucket.key;
+					grown->buckets()[j].callbacks.store(callbacks, std::memory_order_relaxed);
+					grown->buckets()[j].used.store(true, std::memory_order_relaxed);
+					grown->used++;
+				}
+			}
+
+			//Calls in progress keep old table, arrays are shared by both tables.
+			data->_keys.exchange(grown);
+			if (keys != nullptr)
+			{
+				keys->retired_next = data->_retired_indexes;
+				data->_retired_indexes = keys;
+			}
+			keys = grown;
+		}
+
+		const size_t mask = keys->capacity - 1;
+		size_t i = signal_storage::hash_key(key) & mask;
+		while (keys->buckets()[i].used.load(std::memory_order_relaxed))
+			i = (i + 1) & mask;
+
+		key_bucket& bucket = keys->buckets()[i];
+		bucket.key = key;
+		bucket.used.store(true, std::memory_order_release);
+		keys->used++;
+		return bucket.callbacks;
+	}
+
+	static joint_array* copy_array(signal_storage* data, const joint_array* callbacks)
+	{
+		size_t count = callbacks ? callbacks->size.load(std::memory_order_relaxed) : 0;
+		if (count == 0)
+			return nullptr;
+
+		joint_array* copied = allocate_array(data, count);
+		size_t copied_count = 0;
+
+		std::lock_guard<std::mutex> locker(connection_copies_mutex());
+
+		for (size_t i = 0; i < count; i++)
+		{
+			const joint_base* jn = const_cast<joint_array*>(callbacks)->item(i);
+			joint_base* jnt = jn->clone(data->_resource);
+
+			count_memory(memory_kind::callbacks, jnt->size());
+			jnt->connection = jn->connection;
+			jnt->connection->add_copy(data->_self);
+			jnt->forward = jn->forward;
+
+			//connection can be unlocked without updating this signal
+			set_active(copied, copied_count, true);
+			copied->items()[copied_count++].store(jnt, std::memory_order_relaxed);
+		}
+
+		copied->size.store(copied_count, std::memory_order_relaxed);
+		return copied;
+	}
+
+	signal_storage::signal_storage(std::pmr::memory_resource* resource)
+		: _resource(resource)
+		, _forwarders(resource)
+	{
+	}
+
+	signal_storage::~signal_storage()
+	{
+		for_each_array(this, [this](std::atomic<joint_array*>& target)
+		{
+			if (joint_array* callbacks = target.load(std::memory_order_relaxed))
+			{
+				size_t count = callbacks->size.load(std::memory_order_relaxed);
+				for (size_t i = 0; i < count; i++)
+					callbacks->item(i)->destroy(_resource);
+
+				deallocate_array(this, callbacks);
+			}
+		});
+
+		while (joint_array* retired = _retired_arrays)
+		{
+			_retired_arrays = retired->retired_next;
+			deallocate_array(this, retired);
+		}
+
+		if (key_index* keys = _keys.load(std::memory_order_relaxed))
+		{
+			keys->retired_next = _retired_indexes;
+			_retired_indexes = keys;
+		}
+
+		while (key_index* retired = _retired_indexes)
+		{
+			_retired_indexes = retired->retired_next;
+			_resource->deallocate(retired, key_index::bytes(retired->capacity), alignof(key_index));
+		}
+
+		for (joint_base* jnt : _retired_joints)
+			jnt->destroy(_resource);
+
+		for (joint_base* jnt : _freed_joints)
+			jnt->destroy(_resource);
+
+		_retired_joints.release(_resource);
+		_freed_joints.release(_resource);
+
+		count_memory(memory_kind::storage, -(std::ptrdiff_t)_counted_storage);
+	}
+
+	void signal_storage::update_storage_count()
+	{
+		size_t storage = ((size_t)_retired_joints.capacity + _freed_joints.capacity) * sizeof(joint_base*);
+		storage += _forwarders.capacity() * sizeof(std::weak_ptr<connection_data>);
+
+		for_each_array(this, [&storage](std::atomic<joint_array*>& target)
+		{
+			if (const joint_array* callbacks = target.load(std::memory_order_relaxed))
+				storage += joint_array::bytes(callbacks->capacity);
+		});
+
+		for (const joint_array* retired = _retired_arrays; retired != nullptr; retired = retired->retired_next)
+			storage += joint_array::bytes(retired->capacity);
+
+		if (const key_index* keys = _keys.load(std::memory_order_relaxed))
+			storage += key_index::bytes(keys->capacity);
+
+		for (const key_index* retired = _retired_indexes; retired != nullptr; retired = retired->retired_next)
+			storage += key_index::bytes(retired->capacity);
+
+		count_memory(memory_kind::storage, (std::ptrdiff_t)storage - (std::ptrdiff_t)_counted_storage);
+		_counted_storage = storage;
+	}
+
+	void signal_storage::update_active(connection_data* connection)
+	{
+		std::lock_guard<std::mutex> locker(_mutex);
+
+		//keyed connections are compacted with others
+		const bool deleted = connection->deleted;
+		if (deleted)
+		{
+			_maintenance_needed.store(true, std::memory_order_relaxed);
+			_idle.store(false, std::memory_order_relaxed);
+		}
+
+		joint_array* callbacks = _callbacks.load(std::memory_order_relaxed);
+		size_t index = connection->index;
+		if (callbacks == nullptr || index >= callbacks->size.load(std::memory_order_relaxed))
+			return;
+
+		//joint can be already removed by compaction, keyed joint is not in callbacks
+		const joint_base* jnt = callbacks->item(index);
+		if (!jnt->primary || jnt->connection.get() != connection)
+			return;
+
+		set_active(callbacks, index, !deleted && !connection->locked);
+	}
+
+	void signal_storage::delete_deffered(int ending_calls)
+	{
+		compact_storage(this, ending_calls);
+	}
+
+	void signal_storage::destroy_freed()
+	{
+		for (joint_base* jnt : _freed_joints)
+			jnt->destroy(_resource);
+
+		_freed_joints.size = 0;
+	}
+
+	void signal_storage::connect_joint(joint_base* jnt, slot* owner, const std::shared_ptr<connection_data>& connection, const uint64_t* key)
+	{
+		write_lock locker(this);
+		if (owner != nullptr)
+			owner->add_cleaner(connection);
+
+		if (_maintenance_needed.load(std::memory_order_relaxed))
+			compact_storage(this);
+
+		push_callback(this, key ? insert_keyed(this, *key) : _callbacks, jnt);
+		update_single(this);
+		update_storage_count();
+		update_idle();
+	}
+
+	bool signal_storage::replace_joint(joint_base* jnt)
+	{
+		write_lock locker(this);
+		if (jnt->connection->deleted)
+			return false;
+
+		bool replaced = false;
+		for_each_array(this, [this, jnt, &replaced](std::atomic<joint_array*>& callbacks)
+		{
+			replaced = replaced || exchange_joint(this, callbacks, jnt);
+		});
+
+		return replaced;
+	}
+
+	void signal_storage::disconnect_all()
+	{
+		write_lock locker(this);
+
+		for_each_array(this, [](std::atomic<joint_array*>& target)
+		{
+			if (joint_array* callbacks = target.load(std::memory_order_relaxed))
+			{
+				size_t count = callbacks->size.load(std::memory_order_relaxed);
+				for (size_t i = 0; i < count; i++)
+					callbacks->item(i)->connection->deleted = true;
+			}
+		});
+
+		//calls in progress keep old array, joints are freed after them
+		compact_storage(this);
+	}
+
+	void signal_storage::copy_from(signal_storage* rhs)
+	{
+		if (rhs != nullptr)
+			compact_storage(rhs);
+
+		for_each_array(this, [this](std::atomic<joint_array*>& target)
+		{
+			if (joint_array* old = target.load(std::memory_order_relaxed))
+			{
+				size_t count = old->size.load(std::memory_order_relaxed);
+				_retired_joints.reserve(_resource, _retired_joints.size + count);
+				for (size_t i = 0; i < count; i++)
+					_retired_joints.push_back(_resource, old->item(i));
+				publish_array(this, target, nullptr);
+			}
+		});
+
+		if (key_index* keys = _keys.exchange(nullptr))
+		{
+			keys->retired_next = _retired_indexes;
+			_retired_indexes = keys;
+		}
+
+		if (rhs == nullptr)
+		{
+			free_retired(this);
+			return;
+		}
+
+		publish_array(this, _callbacks, copy_array(this, rhs->_callbacks.load(std::memory_order_relaxed)));
+
+		if (key_index* rhs_keys = rhs->_keys.load(std::memory_order_relaxed))
+		{
+			for (size_t i = 0; i < rhs_keys->capacity; i++)
+			{
+				key_bucket& bucket = rhs_keys->buckets()[i];
+				if (!bucket.used.load(std::memory_order_relaxed))
+					continue;
+
+				if (joint_array* copied = copy_array(this, bucket.callbacks.load(std::memory_order_relaxed)))
+					publish_array(this, insert_keyed(this, bucket.key), copied);
+			}
+		}
+
+		free_retired(this);
+	}
+
+	bool signal_storage::empty() const
+	{
+		std::lock_guard<std::mutex> locker(_mutex);
+
+		bool empty = true;
+		for_each_array(const_cast<signal_storage*>(this), [&empty](std::atomic<joint_array*>& target)
+		{
+			const joint_array* callbacks = target.load(std::memory_order_relaxed);
+			empty = empty && (callbacks == nullptr || callbacks->size.load(std::memory_order_relaxed) == 0);
+		});
+
+		return empty;
+	}
+
+	memory_usage_info signal_storage::memory_usage(size_t data_size) const
+	{
+		memory_usage_info usage;
+		std::lock_guard<std::mutex> locker(_mutex);
+		usage.storage = data_size + shared_block_overhead + _counted_storage;
+
+		for_each_array(const_cast<signal_storage*>(this), [&usage](std::atomic<joint_array*>& target)
+		{
+			joint_array* callbacks = target.load(std::memory_order_relaxed);
+			size_t count = callbacks ? callbacks->size.load(std::memory_order_relaxed) : 0;
+			for (size_t i = 0; i < count; i++)
+			{
+				const joint_base* jnt = callbacks->item(i);
+				size_t size = jnt->size();
+				usage.callbacks += size;
+				usage.connections += connection_data::allocated_size;
+
+				if (jnt->connection->deleted)
+				{
+					usage.dead_entries++;
+					usage.dead_bytes += size + connection_data::allocated_size;
+				}
+			}
+		});
+
+		for (const joint_base* jnt : _retired_joints)
+		{
+			size_t size = jnt->size();
+			usage.callbacks += size;
+			usage.dead_entries++;
+			usage.dead_bytes += size;
+		}
+
+		return usage;
+	}
+
+	void signal_storage::add_forwarder(const std::shared_ptr<connection_data>& forward_connection)
+	{
+		std::lock_guard<std::mutex> locker(_mutex);
+		_forwarders.erase(std::remove_if(_forwarders.begin(), _forwarders.end(),
+			[](const std::weak_ptr<connection_data>& forwarder) { return forwarder.expired(); }), _forwarders.end());
+		_forwarders.push_back(forward_connection);
+		update_storage_count();
+	}
+
+	void signal_storage::disconnect_forwarders()
+	{
+		std::pmr::vector<std::weak_ptr<connection_data>> forwarders(_resource);
+		{
+			std::lock_guard<std::mutex> locker(_mutex);
+			forwarders.swap(_forwarders);
+		}
+
+		for (const std::weak_ptr<connection_data>& forwarder : forwarders)
+		{
+			if (std::shared_ptr<connection_data> forward_connection = forwarder.lock())
+			{
+				std::shared_ptr<signal_data_base> source = forward_connection->signal_data.lock();
+				connection(std::move(forward_connection)).disconnect();
+
+				//Deleted forward joint hold this data until source is compacted,
+				//forwards disconnected by slot can make a cycle.
+				if (source)
+					source->try_compact();
+			}
+		}
+	}
+
+	bool signal_storage::is_forwarding(signal_storage* from, signal_storage* data)
+	{
+		std::pmr::vector<signal_storage*> visited(from->_resource);
+		std::pmr::vector<signal_storage*> pending(1, from, from->_resource);
+
+		while (!pending.empty())
+		{
+			signal_storage* current = pending.back();
+			pending.pop_back();
+			if (current == data)
+				return true;
+
+			if (std::find(visited.begin(), visited.end(), current) != visited.end())
+				continue;
+			visited.push_back(current);
+
+			std::lock_guard<std::mutex> locker(current->_mutex);
+			if (joint_array* callbacks = current->_callbacks.load(std::memory_order_relaxed))
+			{
+				size_t count = callbacks->size.load(std::memory_order_relaxed);
+				for (size_t i = 0; i < count; i++)
+				{
+					const joint_base* jnt = callbacks->item(i);
+					if (jnt->forward != nullptr && !jnt->connection->deleted)
+						pending.push_back(jnt->forward);
+				}
+			}
+		}
+
+		return false;
+	}
+
+#ifdef LSIGNAL_COROUTINES
+	uint64_t signal_storage::awaiters_seq() const
+	{
+		std::lock_guard<std::mutex> locker(_mutex);
+		return _awaiters_seq;
+	}
+
+	//Called under _mutex.
+	static void unlink_awaiter(signal_storage* data, awaiter_node* aw)
+	{
+		if (aw->prev)
+			aw->prev->next = aw->next;
+		else
+			data->_awaiters_first = aw->next;
+
+		if (aw->next)
+			aw->next->prev = aw->prev;
+		else
+			data->_awaiters_last = aw->prev;
+
+		data->_has_awaiters.store(data->_awaiters_first != nullptr, std::memory_order_relaxed);
+		data->update_idle();
+
+		aw->prev = aw->next = nullptr;
+		aw->linked = false;
+		if (aw->cleaner)
+			aw->cleaner->node = nullptr;
+	}
+
+	bool signal_storage::link_awaiter(awaiter_node* aw)
+	{
+		std::lock_guard<std::mutex> locker(_mutex);
+		if (_awaiters_closed || (aw->cleaner && aw->cleaner->cancelled))
+			return false;
+
+		aw->seq = _awaiters_seq++;
+		aw->prev = _awaiters_last;
+		if (aw->prev)
+			aw->prev->next = aw;
+		else
+			_awaiters_first = aw;
+		_awaiters_last = aw;
+		_has_awaiters.store(true, std::memory_order_relaxed);
+		update_idle();
+		aw->linked = true;
+		if (aw->cleaner)
+			aw->cleaner->node = aw;
+		return true;
+	}
+
+	void signal_storage::remove_awaiter(awaiter_node* aw)
+	{
+		std::lock_guard<std::mutex> locker(_mutex);
+		if (aw->linked)
+			unlink_awaiter(this, aw);
+	}
+
+	awaiter_node* signal_storage::pop_awaiter(uint64_t seq_limit)
+	{
+		std::lock_guard<std::mutex> locker(_mutex);
+		awaiter_node* aw = _awaiters_first;
+		if (aw == nullptr || aw->seq >= seq_limit)
+			return nullptr;
+
+		unlink_awaiter(this, aw);
+		return aw;
+	}
+
+	void signal_storage::resume_awaiters(uint64_t seq_limit, const void* const* args)
+	{
+		//Awaiters added while resuming wait for next call.
+		//Pop one by one, because resumed coroutine can destroy frames of other awaiters.
+		while (awaiter_node* aw = pop_awaiter(seq_limit))
+		{
+			aw->set_value(aw, args);
+			aw->handle.resume();
+		}
+	}
+
+	void signal_storage::close_awaiters()
+	{
+		uint64_t seq_limit;
+		{
+			std::lock_guard<std::mutex> locker(_mutex);
+			seq_limit = _awaiters_seq;
+			_awaiters_closed = true;
+		}
+
+		//resume with std::nullopt
+		while (awaiter_node* aw = pop_awaiter(seq_limit))
+			aw->handle.resume();
+	}
+
+	std::shared_ptr<awaiter_cleaner> signal_storage::make_awaiter_cleaner(slot* owner)
+	{
+		std::shared_ptr<awaiter_cleaner> cleaner = std::allocate_shared<awaiter_cleaner>(resource_allocator<awaiter_cleaner>(_resource));
+		cleaner->deleted = true;
+		cleaner->awaiter = true;
+		cleaner->signal_data = _self;
+		cleaner->resource = _resource;
+		owner->add_cleaner(cleaner);
+		return cleaner;
+	}
+
+	void signal_storage::cancel_awaiter(awaiter_cleaner* cleaner)
+	{
+		std::shared_ptr<signal_data_base> signal_data = cleaner->signal_data.lock();
+		if (!signal_data)
+			return;
+
+		signal_storage* data = static_cast<signal_storage*>(signal_data.get());
+		awaiter_node* aw = nullptr;
+		{
+			std::lock_guard<std::mutex> locker(data->_mutex);
+			cleaner->cancelled = true;
+			aw = cleaner->node;
+			if (aw != nullptr)
+				unlink_awaiter(data, aw);
+		}
+
+		//resume with std::nullopt
+		if (aw != nullptr)
+			aw->handle.resume();
+	}
+
+	awaiter_cleaner::awaiter_cleaner()
+	{
+		count_memory(memory_kind::connections, sizeof(awaiter_cleaner) - sizeof(connection_data));
+	}
+
+	awaiter_cleaner::~awaiter_cleaner()
+	{
+		count_memory(memory_kind::connections, -(std::ptrdiff_t)(sizeof(awaiter_cleaner) - sizeof(connection_data)));
+	}
+#endif
+
+	// dispatcher
+
+	struct dispatcher::thread_queue
+	{
+		static constexpr size_t block_size = 16 * 1024;
+
+		struct block
+		{
+			block* next;
+			size_t size;
+
+			unsigned char* data() { return reinterpret_cast<unsigned char*>(this) + sizeof(block); }
+		};
+
+		struct merge_slot
+		{
+			const void* key;
+			posted* entry;
+			uint64_t seq;
+		};
+
+		posted* head = nullptr;
+		posted* tail = nullptr;
+		size_t count = 0;
+		uint64_t next_seq = 0;
+		//Queue is FIFO, post with seq <= last_run_seq is called.
+		uint64_t last_run_seq = 0;
+		//run_pending() on stack, arena is reset by outer one
+		int running = 0;
+
+		//Blocks are kept, current is the one being filled.
+		block* first = nullptr;
+		block* current = nullptr;
+		size_t used = 0;
+
+		//Open addressing by key, slots of called posts are replaced, table is cleared with arena.
+		std::vector<merge_slot> merged;
+		size_t merged_count = 0;
+
+		~thread_queue()
+		{
+			drop();
+			while (block* b = first)
+			{
+				first = b->next;
+				::operator delete(b);
+			}
+		}
+
+		void* allocate(size_t size, size_t align)
+		{
+			for (;;)
+			{
+				if (current != nullptr)
+				{
+					size_t offset = (used + align - 1) & ~(align - 1);
+					if (offset + size <= current->size)
+					{
+						used = offset + size;
+						return current->data() + offset;
+					}
+
+					if (current->next != nullptr)
+					{
+						current = current->next;
+						used = 0;
+						continue;
+					}
+				}
+
+				size_t size_needed = std::max(block_size, (size + align + sizeof(block) + 63) / 64 * 64);
+				block* b = static_cast<block*>(::operator new(size_needed));
+				b->next = nullptr;
+				b->size = size_needed - sizeof(block);
+				if (current != nullptr)
+					current->next = b;
+				else
+					first = b;
+				current = b;
+				used = 0;
+			}
+		}
+
+		//Empty queue reuse arena and merge table.
+		void reset()
+		{
+			current = first;
+			used = 0;
+
+			if (merged_count != 0)
+			{
+				std::fill(merged.begin(), merged.end(), merge_slot{});
+				merged_count = 0;
+			}
+		}
+
+		void drop()
+		{
+			while (posted* p = head)
+			{
+				head = p->next;
+				last_run_seq = p->seq;
+				p->run(p, false);
+			}
+
+			tail = nullptr;
+			count = 0;
+		}
+
+		static size_t hash(const void* key)
+		{
+			return (size_t)(((uintptr_t)key >> 4) * 0x9E3779B97F4A7C15ull);
+		}
+
+		merge_slot* find_slot(const void* key)
+		{
+			const size_t mask = merged.size() - 1;
+			for (size_t i = hash(key) & mask;; i = (i + 1) & mask)
+			{
+				if (merged[i].key == key || merged[i].key == nullptr)
+					return &merged[i];
+			}
+		}
+
+		void insert_merged(const void* key, posted* entry)
+		{
+			if ((merged_count + 1) * 2 > merged.size())
+			{
+				//only pending posts are moved to new table
+				std::vector<merge_slot> old(std::max<size_t>(16, merged.size() * 2));
+				old.swap(merged);
+				merged_count = 0;
+				for (const merge_slot& slot : old)
+				{
+					if (slot.key != nullptr && slot.seq > last_run_seq)
+					{
+						*find_slot(slot.key) = slot;
+						merged_count++;
+					}
+				}
+			}
+
+			merge_slot* slot = find_slot(key);
+			if (slot->key == nullptr)
+				merged_count++;
+			*slot = merge_slot{ key, entry, entry->seq };
+		}
+	};
+
+	dispatcher::thread_queue& dispatcher::local()
+	{
+		thread_local thread_queue queue;
+		return queue;
+	}
+
+	size_t dispatcher::run_pending()
+	{
+		thread_queue& queue = local();
+
+		struct run_guard
+		{
+			thread_queue& queue;
+			~run_guard()
+			{
+				if (--queue.running == 0 && queue.head == nullptr)
+					queue.reset();
+			}
+		} guard{ queue };
+		queue.running++;
+
+		size_t called = 0;
+		while (posted* p = queue.head)
+		{
+			queue.head = p->next;
+			if (queue.head == nullptr)
+				queue.tail = nullptr;
+			queue.count--;
+			//post_merged made by this call add new post
+			queue.last_run_seq = p->seq;
+			called++;
+
+			p->run(p, true);
+		}
+
+		return called;
+	}
+
+	size_t dispatcher::pending()
+	{
+		return local().count;
+	}
+
+	void dispatcher::clear()
+	{
+		thread_queue& queue = local();
+		queue.drop();
+		if (queue.running == 0)
+			queue.reset();
+	}
+
+	size_t dispatcher::arena_capacity()
+	{
+		size_t capacity = 0;
+		for (thread_queue::block* b = local().first; b != nullptr; b = b->next)
+			capacity += b->size;
+		return capacity;
+	}
+
+	void* dispatcher::allocate(size_t size, size_t align)
+	{
+		return local().allocate(size, align);
+	}
+
+	void dispatcher::push(posted* p, const void* merge_key)
+	{
+		thread_queue& queue = local();
+		p->next = nullptr;
+		p->seq = ++queue.next_seq;
+
+		if (queue.tail != nullptr)
+			queue.tail->next = p;
+		else
+			queue.head = p;
+		queue.tail = p;
+		queue.count++;
+
+		if (merge_key != nullptr)
+			queue.insert_merged(merge_key, p);
+	}
+
+	dispatcher::posted* dispatcher::find_merged(const void* merge_key)
+	{
+		thread_queue& queue = local();
+		if (queue.merged_count == 0)
+			return nullptr;
+
+		thread_queue::merge_slot* slot = queue.find_slot(merge_key);
+		return slot->key == merge_key && slot->seq > queue.last_run_seq ? slot->entry : nullptr;
+	}
+}//namespace lsignal
+
+LSIGNAL_INSTANTIATE_SIGNAL(void());
+LSIGNAL_INSTANTIATE_SIGNAL(void(bool));
+LSIGNAL_INSTANTIATE_SIGNAL(void(int));
+LSIGNAL_INSTANTIATE_SIGNAL(void(float));
+LSIGNAL_INSTANTIATE_SIGNAL(void(double));
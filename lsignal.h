@@ -28,16 +28,36 @@ Cloned to https://github.com/balmerdx/lsignal
 
 #pragma once
 
+#include "lsignal_fwd.h"
+
 #include <functional>
-#include <list>
 #include <memory>
+#include <memory_resource>
+#include <new>
+#include <exception>
 #include <mutex>
+#include <atomic>
 #include <vector>
 #include <algorithm>
+#include <utility>
+#include <tuple>
+#include <string>
+#include <cstdint>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+#include <coroutine>
+#include <optional>
+#include <tuple>
+#define LSIGNAL_COROUTINES 1
+#endif
 
 namespace lsignal
 {
-	template<int>
+	template<size_t>
 	struct placeholder_lsignal
 	{
 	};
@@ -47,43 +67,336 @@ namespace std
 {
 	// custom std::placeholders
 
-	template<int N>
+	template<size_t N>
 	struct is_placeholder<lsignal::placeholder_lsignal<N>>
-		: integral_constant<int, N+1>
+		: integral_constant<int, (int)N + 1>
 	{
 	};
 }
 
 namespace lsignal
 {
-	// std::integer_sequence for C++11
+	// bit scan
+
+	inline unsigned count_trailing_zeros(uint64_t bits)
+	{
+#if defined(_MSC_VER) && defined(_M_IX86)
+		//no 64-bit scan on 32-bit x86, bits is not zero
+		unsigned long index;
+		if (_BitScanForward(&index, (unsigned long)bits))
+			return (unsigned)index;
+
+		_BitScanForward(&index, (unsigned long)(bits >> 32));
+		return (unsigned)index + 32;
+#elif defined(_MSC_VER)
+		unsigned long index;
+		_BitScanForward64(&index, bits);
+		return (unsigned)index;
+#else
+		return (unsigned)__builtin_ctzll(bits);
+#endif
+	}
+
+	// memory usage
+
+	struct memory_usage_info
+	{
+		//callbacks, functors are stored inline
+		size_t callbacks = 0;
+		//connection records shared by signal, connection and slot
+		size_t connections = 0;
+		//signal internal data and callback arrays
+		size_t storage = 0;
+		//slot cleaner arrays
+		size_t cleaners = 0;
+
+		//deleted connections held by signals until next call or compaction, and by slots
+		size_t dead_entries = 0;
+		//bytes of dead entries, already included in fields above
+		size_t dead_bytes = 0;
+
+		size_t total() const;
+		memory_usage_info& operator+= (const memory_usage_info& rhs);
+	};
+
+	//Allocator of std::allocate_shared for signal data and connections. Unlike
+	//std::pmr::polymorphic_allocator it don't construct by uses-allocator protocol, which is
+	//instantiated for every signature and callable.
+	template<typename T>
+	struct resource_allocator
+	{
+		using value_type = T;
+
+		std::pmr::memory_resource* resource;
+
+		explicit resource_allocator(std::pmr::memory_resource* res) : resource(res) {}
+		template<typename U>
+		resource_allocator(const resource_allocator<U>& rhs) : resource(rhs.resource) {}
+
+		T* allocate(size_t count) { return static_cast<T*>(resource->allocate(count * sizeof(T), alignof(T))); }
+		void deallocate(T* p, size_t count) { resource->deallocate(p, count * sizeof(T), alignof(T)); }
+
+		template<typename U>
+		bool operator== (const resource_allocator<U>& rhs) const { return resource == rhs.resource; }
+		template<typename U>
+		bool operator!= (const resource_allocator<U>& rhs) const { return resource != rhs.resource; }
+	};
+
+	//Overhead of std::allocate_shared with resource_allocator (control block)
+	const size_t shared_block_overhead = 2 * sizeof(void*) + sizeof(resource_allocator<char>);
+
+	enum class memory_kind
+	{
+		callbacks,
+		connections,
+		storage,
+		cleaners
+	};
+
+	//Update global counters, used by signal and slot.
+	void count_memory(memory_kind kind, std::ptrdiff_t bytes);
+
+	//Memory allocated now by all signals, connections and slots.
+	//Dead entries are not tracked globally.
+	memory_usage_info global_memory_usage();
+
+	// signal data shared with connections
+
+	struct connection_data;
+
+	struct signal_data_base
+	{
+		//Taken only by writers (connect, copy, compaction) and coroutine awaiters, never by signal call.
+		mutable std::mutex _mutex;
+		//Signal calls in progress by parity of epoch they started in (31 bits each, see call_unit)
+		//and released_bit. Retired memory is freed only when both are zero. wait_calls() advance
+		//epoch and wait calls of old parity. One word, so call which ends last see that signal
+		//was destroyed and free its data, call itself don't hold signal data.
+		std::atomic<uint64_t> _calls{0};
+		//deleted connections seen by call, or retired memory waits until calls end
+		std::atomic<bool> _maintenance_needed{false};
+		//call never compact, see signal::set_realtime()
+		std::atomic<bool> _realtime{false};
+		std::atomic<uint8_t> _call_epoch{0};
+		//Spin lock of wait_calls() held only while previous parity is checked and epoch is flipped,
+		//never while calls are waited. Not a mutex, signal data of never waited signals stay small.
+		std::atomic<bool> _waiting{false};
+		//Joints freed under _mutex wait for write_lock::unlock(), guarded by _mutex.
+		bool _has_freed = false;
+		//Set while one write_lock destroys freed joints without _mutex.
+		std::atomic<bool> _destroying_freed{false};
+
+		//set in _calls by destructor of signal
+		static const uint64_t released_bit = uint64_t(1) << 63;
+
+		virtual ~signal_data_base();
+
+		//Added to _calls by call started in epoch.
+		static uint64_t call_unit(unsigned epoch) { return uint64_t(1) << (32 * epoch); }
+
+		//Remove deleted connections now. Memory is freed now if signal not called at this moment,
+		//otherwise by next compaction.
+		void compact();
+		//Same as compact(), but do nothing if other thread hold _mutex. Ending call is still
+		//counted by caller, its memory can be freed.
+		void try_compact(int ending_calls = 0);
+
+		int calls_in_progress() const;
+		//Wait until calls started before this method are finished, so calls which don't see
+		//connection deleted before it are over. Calls of current thread are not waited.
+		void wait_calls();
+
+		//Update active mask after connection locked, unlocked or disconnected.
+		virtual void update_active(connection_data* connection) = 0;
+
+		//Lock of _mutex taken by writers. Joints freed under it are destroyed after unlock,
+		//so destructor of callable can lock, disconnect or connect on this signal.
+		class write_lock
+		{
+		public:
+			explicit write_lock(signal_data_base* data);
+			write_lock(signal_data_base* data, std::defer_lock_t);
+			write_lock(signal_data_base* data, std::try_to_lock_t);
+			~write_lock();
+
+			write_lock(const write_lock&) = delete;
+			write_lock& operator=(const write_lock&) = delete;
+
+			void lock();
+			bool try_lock();
+			void unlock();
+			bool owns_lock() const { return _owns; }
+		private:
+			signal_data_base* _data;
+			bool _owns;
+		};
+	protected:
+		//Called under _mutex.
+		virtual void delete_deffered(int ending_calls) = 0;
+		//Destroy joints freed under _mutex, called without it by one thread at a time.
+		virtual void destroy_freed() = 0;
+	};
 
-	template<int... Ns>
-	struct int_sequence
+	//Taken by signal::forward_to while it check and add edge of forwarding graph,
+	//so concurrent forwards can't make a cycle.
+	std::mutex& forward_graph_mutex();
+
+	//Signal call on stack of current thread with chain of fused forwards it called.
+	//Lets wait_calls() skip calls of the waiting thread.
+	struct call_frame
+	{
+		static const size_t max_depth = 16;
+
+		const call_frame* prev = nullptr;
+		size_t depth = 0;
+		signal_data_base* chain[max_depth];
+		unsigned epochs[max_depth];
+		bool found_deleted[max_depth];
+	};
+
+	inline thread_local const call_frame* current_call_frame = nullptr;
+
+	//Error sink of catch_and_continue signal data, empty base for other policies.
+	template<exception_policy Policy>
+	struct error_sink_holder
+	{
+	};
+
+	template<>
+	struct error_sink_holder<exception_policy::catch_and_continue>
+	{
+		//guarded by _mutex of signal data, called on exception only
+		std::function<void(std::exception_ptr)> _error_sink;
+	};
+
+	//Guard copies list of all connections, taken when signal is copied.
+	std::mutex& connection_copies_mutex();
+
+	// profiler
+
+	//Time stamp counter on x86, steady clock nanoseconds on other targets.
+	//Read only by sampled calls, so it is not inlined.
+	uint64_t profile_ticks();
+
+	//Counters of connections with one label, created by first connect_labeled with it and never freed.
+	struct profile_record
 	{
+		std::string label;
+		//timed calls and their time in profile_ticks()
+		std::atomic<uint64_t> samples{0};
+		std::atomic<uint64_t> ticks{0};
 	};
 
-	template<int N, int... Ns>
-	struct make_int_sequence
-		: make_int_sequence<N-1, N-1, Ns...>
+	//Time sampled call of labeled connection, record is nullptr if call is not sampled.
+	struct profile_scope
 	{
+		profile_record* record;
+		uint64_t start = 0;
+
+		explicit profile_scope(profile_record* rec)
+			: record(rec)
+		{
+			if (record != nullptr)
+				start = profile_ticks();
+		}
+
+		~profile_scope()
+		{
+			if (record == nullptr)
+				return;
+
+			record->samples.fetch_add(1, std::memory_order_relaxed);
+			record->ticks.fetch_add(profile_ticks() - start, std::memory_order_relaxed);
+		}
 	};
 
-	template<int... Ns>
-	struct make_int_sequence<0, Ns...>
-		: int_sequence<Ns...>
+	struct profile_entry
 	{
+		std::string label;
+		uint64_t samples = 0;
+		uint64_t nanoseconds = 0;
+	};
+
+	//Sampling profiler of connections made by signal::connect_labeled. Every sampling period-th
+	//call of each labeled connection is timed, time is summed by label.
+	//While period is 0 (default) signal call only read it.
+	class profiler
+	{
+		template<typename, exception_policy>
+		friend class signal;
+	public:
+		static void set_sampling_period(uint32_t period);
+		static uint32_t sampling_period();
+		//Labels with largest sampled time, at most count, sorted by it. Tick rate is measured
+		//since profiler was enabled first time: called sooner than 10 ms after it, top() sleeps the rest.
+		static std::vector<profile_entry> top(size_t count);
+		//Zero counters of all labels.
+		static void reset();
+	private:
+		inline static std::atomic<uint32_t> _period{0};
+
+		static profile_record* find_record(const char* label);
+		//Measured against steady clock since profiler was enabled first time.
+		static double ticks_per_nanosecond();
+
+		//Read once by signal call, 0 if profiler is disabled.
+		static uint32_t period()
+		{
+			return _period.load(std::memory_order_relaxed);
+		}
+	};
+
+	//Move-only functor of connection is shared by its clones in signal copies instead of copied.
+	//Empty for copyable functors.
+	template<typename Impl, bool Shared>
+	struct functor_owners
+	{
+	};
+
+	template<typename Impl>
+	struct functor_owners<Impl, true>
+	{
+		//joint which stores functor, itself for joint made by connect or replace
+		Impl* origin = nullptr;
+		//joints sharing functor of origin, last of them destroys it
+		std::atomic<uint32_t> holders{1};
+		//resource of origin allocated alone, set when origin is destroyed before its clones
+		std::pmr::memory_resource* resource = nullptr;
 	};
 
 	// connection
 
 	struct connection_data
 	{
-		bool locked = false;
-		bool deleted = false;
+		//changed from any thread, read by signal call without lock
+		std::atomic<bool> locked{false};
+		std::atomic<bool> deleted{false};
+		//cleaner of signal::next(owner), not a connection, see awaiter_cleaner
+		bool awaiter = false;
+		//index of joint in callbacks of signal which own this connection, guarded by its mutex
+		uint32_t index = 0;
+
+		//signal which own this connection
+		std::weak_ptr<signal_data_base> signal_data;
+		//signal copies which hold clones of callback, guarded by connection_copies_mutex(),
+		//list is allocated from resource
+		using copy_list = std::pmr::vector<std::weak_ptr<signal_data_base>>;
+		copy_list* copies = nullptr;
+		//label of connect_labeled, set before connection is published
+		profile_record* profile = nullptr;
+		//memory resource of signal which own this connection
+		std::pmr::memory_resource* resource = std::pmr::get_default_resource();
+
+		//bytes allocated by std::allocate_shared<connection_data>
+		static const size_t allocated_size;
 
 		connection_data();
 		~connection_data();
+
+		//Called under connection_copies_mutex(), expired copies are removed.
+		void add_copy(const std::shared_ptr<signal_data_base>& copy);
+		//Signal which own connection and its copies, they can call callback.
+		void get_signals(std::pmr::vector<std::shared_ptr<signal_data_base>>& signals) const;
 	};
 
 	struct connection_cleaner
@@ -96,7 +409,7 @@ namespace lsignal
 
 	class connection
 	{
-		template<typename>
+		template<typename, exception_policy>
 		friend class signal;
 
 	public:
@@ -108,325 +421,1633 @@ namespace lsignal
 		void set_lock(const bool lock);
 
 		void disconnect();
+		//Disconnect and wait until calls of callback in other threads are finished, callback
+		//is not called after it return. From callback it don't wait for call of current thread.
+		//Like thread join, it deadlocks if callback waits for thread which calls it.
+		void disconnect_and_wait();
+
+		//Label of connect_labeled, nullptr for other connections.
+		const char* label() const;
 	private:
 		std::shared_ptr<connection_data> _data;
 	};
 
 
+	//Cleaners of slot in connect order. Lookup by signal groups them first: appended entries are
+	//sorted by signal they connect to (owner of signal data) and merged into grouped prefix,
+	//connections of one signal stay in connect order. First entries are stored inline.
+	class cleaner_map
+	{
+	public:
+		static const size_t inline_capacity = 2;
+
+		explicit cleaner_map(std::pmr::memory_resource* resource);
+		//Take entries of rhs, rhs is empty after it.
+		cleaner_map(cleaner_map&& rhs);
+		~cleaner_map();
+
+		cleaner_map(const cleaner_map& rhs) = delete;
+		cleaner_map& operator= (const cleaner_map& rhs) = delete;
+
+		connection_cleaner* begin() { return _items; }
+		connection_cleaner* end() { return _items + _size; }
+		const connection_cleaner* begin() const { return _items; }
+		const connection_cleaner* end() const { return _items + _size; }
+		size_t size() const { return _size; }
+		std::pmr::memory_resource* resource() const { return _resource; }
+
+		//Heap array, or used inline entries.
+		size_t bytes() const;
+
+		//Cleaners of connections to signal with this data, entries are grouped.
+		std::pair<connection_cleaner*, connection_cleaner*> equal_range(const std::shared_ptr<signal_data_base>& signal_data) const;
+		//Append, entries are grouped by next lookup.
+		void insert(const std::shared_ptr<connection_data>& connection);
+		void erase(connection_cleaner* first, connection_cleaner* last);
+		//Sort and merge entries appended after last grouping.
+		void group() const;
+	private:
+		connection_cleaner* _items;
+		uint32_t _size = 0;
+		uint32_t _capacity = inline_capacity;
+		//entries before it are grouped by signal
+		mutable uint32_t _grouped = 0;
+		std::pmr::memory_resource* _resource;
+		alignas(connection_cleaner) unsigned char _inline[inline_capacity * sizeof(connection_cleaner)];
+
+		bool is_inline() const { return _items == reinterpret_cast<const connection_cleaner*>(_inline); }
+		void grow();
+	};
+
 	// slot
 	class slot
 	{
-		template<typename>
+		template<typename, exception_policy>
 		friend class signal;
+		friend struct signal_storage;
 	public:
 		slot();
+		//Cleaner array allocated from resource.
+		explicit slot(std::pmr::memory_resource* resource);
+		//Copy has no connections, connections made with rhs as owner stay owned by rhs only.
+		//Memory resource and set_compact_signals() are copied.
+		slot(const slot& rhs);
+		//Own connections stay, connections of rhs are not taken.
+		slot& operator= (const slot& rhs);
 		virtual ~slot();
 
 		void disconnect();
+		//Disconnect all and wait until their calls in other threads are finished,
+		//see connection::disconnect_and_wait().
+		void disconnect_and_wait();
+
+		//Cleaner arrays. Cleaners of disconnected connections are dead entries,
+		//they are held until slot disconnect() or destruction.
+		memory_usage_info memory_usage() const;
+
+		//If true disconnect() and destructor also remove deleted connections from signals
+		//instead of waiting next signal call. Useful for rarely called signals.
+		bool is_compact_signals() const;
+		void set_compact_signals(const bool compact);
+
+		//Disconnect only connections to sig (made with this slot as owner), other connections stay.
+		//Cleaners connected since last lookup are grouped by signal first, then found by binary search.
+		template<typename R, typename... Args, exception_policy Policy>
+		void disconnect_from(const signal<R(Args...), Policy>& sig);
+
+		//Connections to sig not disconnected yet.
+		template<typename R, typename... Args, exception_policy Policy>
+		size_t connection_count(const signal<R(Args...), Policy>& sig) const;
+		//All connections not disconnected yet.
+		size_t connection_count() const;
+		//Count of signals this slot has connections to.
+		size_t signal_count() const;
+		//Connections not disconnected yet, grouped by signal. For debugging.
+		std::vector<connection> connections() const;
+	private:
+		void add_cleaner(const std::shared_ptr<connection_data>& connection);
+		void disconnect_cleaners(const bool wait);
+		void disconnect_signal(const std::shared_ptr<signal_data_base>& signal_data);
+		size_t count_connections(const std::shared_ptr<signal_data_base>& signal_data) const;
+
+		cleaner_map _cleaners;
+		bool _compact_signals = false;
+	};
+
+	// dispatcher
+
+	//Queue of calls made by signal::post() on current thread, called by run_pending() of the same
+	//thread in post order. Posts are allocated in arena of thread which is reused when queue is empty,
+	//so steady stream of posts don't allocate memory.
+	class dispatcher
+	{
+		template<typename, exception_policy>
+		friend class signal;
+	public:
+		//Call posts of current thread, including posts made by them, return count of calls.
+		//Exception of callback leaves with the rest of queue pending.
+		static size_t run_pending();
+		//Posts of current thread not called yet.
+		static size_t pending();
+		//Drop posts of current thread without calling them.
+		static void clear();
+		//Bytes of arena blocks of current thread, kept for next posts.
+		static size_t arena_capacity();
 	private:
-		std::vector<connection_cleaner> _cleaners;
+		struct posted
+		{
+			posted* next = nullptr;
+			//position in queue of thread
+			uint64_t seq = 0;
+			//call if call is true, then destroy
+			void (*run)(posted* p, bool call) = nullptr;
+		};
+
+		struct thread_queue;
+		static thread_queue& local();
+
+		static void* allocate(size_t size, size_t align);
+		//Add to queue, post with merge key is found by find_merged until it is called.
+		static void push(posted* p, const void* merge_key);
+		static posted* find_merged(const void* merge_key);
+	};
+
+	// signal storage
+
+	struct signal_storage;
+	//Suspended coroutine linked into signal, defined with LSIGNAL_COROUTINES.
+	struct awaiter_node;
+	struct awaiter_cleaner;
+
+	//Connection stored in signal without signature, signal<Signature>::joint adds call and predicate.
+	struct joint_base
+	{
+		//Joint made by connect is allocated in one block with its connection_data and
+		//hold it until destroy(), so flags read by call are next to callback.
+		//Joints of signal copies are allocated alone and share connection of original.
+		std::shared_ptr<connection_data> connection;
+		//false for empty std::function or null function pointer
+		bool callable = true;
+		bool in_block = false;
+		//made by connect or replace of this signal, not clone of signal copy
+		bool primary = false;
+		//calls left until sampled one, see sample()
+		mutable std::atomic<uint32_t> sample_countdown{0};
+		//signal called by forward_to joint
+		signal_storage* forward = nullptr;
+
+		virtual ~joint_base() {}
+
+		//Label record if this call of labeled connection is timed, every period-th call is.
+		//Threads calling one joint at once can sample a call more or less, countdown is not a read-modify-write.
+		profile_record* sample(uint32_t period) const
+		{
+			profile_record* record = connection->profile;
+			if (record == nullptr)
+				return nullptr;
+
+			//first call and call after period was lowered are sampled
+			const uint32_t left = sample_countdown.load(std::memory_order_relaxed);
+			if (left > 1 && left <= period)
+			{
+				sample_countdown.store(left - 1, std::memory_order_relaxed);
+				return nullptr;
+			}
+
+			sample_countdown.store(period, std::memory_order_relaxed);
+			return record;
+		}
+		//Copy of functor and predicate, move-only functor is shared with clone.
+		virtual joint_base* clone(std::pmr::memory_resource* resource) const = 0;
+		//Destroy functor. Joint allocated alone is deallocated from resource,
+		//joint in block is freed with connection_data.
+		virtual void destroy(std::pmr::memory_resource* resource) = 0;
+		//allocated bytes with functor
+		virtual size_t size() const = 0;
+	};
+
+	//Contiguous callback storage, items follow the header.
+	//Writers only append after size, replace item or publish new array, so call read it without lock.
+	struct joint_array
+	{
+		std::atomic<size_t> size{0};
+		size_t capacity = 0;
+		//list of retired arrays, guarded by _mutex
+		joint_array* retired_next = nullptr;
+
+		//Item is replaced in place by signal::replace, call load it with acquire.
+		std::atomic<joint_base*>* items() { return reinterpret_cast<std::atomic<joint_base*>*>(this + 1); }
+		//Read by writer under _mutex.
+		joint_base* item(size_t index) { return items()[index].load(std::memory_order_relaxed); }
+		//Bit per item, call visit only set bits. Bit is cleared when connection made by
+		//connect on this signal is locked or disconnected. Joints of copies keep bits set.
+		std::atomic<uint64_t>* mask() { return reinterpret_cast<std::atomic<uint64_t>*>(items() + capacity); }
+
+		static size_t mask_words(size_t capacity) { return (capacity + 63) / 64; }
+		static size_t bytes(size_t capacity) { return sizeof(joint_array) + capacity * sizeof(std::atomic<joint_base*>) + mask_words(capacity) * sizeof(uint64_t); }
+	};
+
+	//Bucket of keyed index. Key is written before used is set and never changes,
+	//callbacks are replaced and retired as main callbacks array.
+	struct key_bucket
+	{
+		uint64_t key = 0;
+		std::atomic<joint_array*> callbacks{nullptr};
+		std::atomic<bool> used{false};
+	};
+
+	//Open addressing hash table of keyed connections, buckets follow the header.
+	//Table is replaced as whole when it grows, old one is retired.
+	struct key_index
+	{
+		//power of two
+		size_t capacity = 0;
+		//buckets with used set, guarded by _mutex
+		size_t used = 0;
+		key_index* retired_next = nullptr;
+
+		key_bucket* buckets() { return reinterpret_cast<key_bucket*>(this + 1); }
+		static size_t bytes(size_t capacity) { return sizeof(key_index) + capacity * sizeof(key_bucket); }
+	};
+
+	//Retired or freed joints, items are allocated from memory resource of signal.
+	//Half of std::pmr::vector, signal data keep two of them.
+	struct joint_list
+	{
+		joint_base** items = nullptr;
+		uint32_t size = 0;
+		uint32_t capacity = 0;
+
+		joint_base** begin() const { return items; }
+		joint_base** end() const { return items + size; }
+		bool empty() const { return size == 0; }
+
+		void reserve(std::pmr::memory_resource* resource, size_t count);
+		void push_back(std::pmr::memory_resource* resource, joint_base* jnt);
+		void release(std::pmr::memory_resource* resource);
+	};
+
+	//Signal data of every signature: callback arrays, keyed index, retired memory, forwards and
+	//awaiters. Writers are compiled once in lsignal.cpp, signal<Signature> adds functors and call.
+	struct signal_storage : public signal_data_base
+	{
+		//Reference of signal, released by its destructor or by last call in progress at that moment.
+		//Forwards, awaiters and connections (weak) share it, so signal data outlive signal destroyed in callback.
+		std::shared_ptr<signal_storage> _self;
+
+		//Joints are owned by current array.
+		//Signal call capture array and size, so joints added during call are not called.
+		//Arrays replaced by growth or compaction and joints removed by compaction or assignment
+		//are retired, writers free them when no call in progress.
+		std::atomic<joint_array*> _callbacks{nullptr};
+		//Joint of _callbacks when it has exactly one, call use it instead of array. Connect and
+		//compaction switch it, array still holds the joint, so call which read it before the
+		//switch find joint in array.
+		std::atomic<joint_base*> _single{nullptr};
+		joint_array* _retired_arrays = nullptr;
+
+		//connections of connect_keyed, nullptr until first of them
+		std::atomic<key_index*> _keys{nullptr};
+		key_index* _retired_indexes = nullptr;
+		joint_list _retired_joints;
+		//Joints no call can see, destroyed by write_lock after unlock. Swapped with
+		//_retired_joints, so both keep their capacity.
+		joint_list _freed_joints;
+
+		std::pmr::memory_resource* _resource;
+
+		//connections which forward to this signal, disconnected by ~signal
+		std::pmr::vector<std::weak_ptr<connection_data>> _forwarders;
+
+		//Intrusive list of suspended coroutines, resumed in order of co_await.
+		//Present without LSIGNAL_COROUTINES too (always empty), layout is the same in every mode.
+		awaiter_node* _awaiters_first = nullptr;
+		awaiter_node* _awaiters_last = nullptr;
+		uint64_t _awaiters_seq = 0;
+		//_awaiters_first != nullptr, checked by call without lock
+		std::atomic<bool> _has_awaiters{false};
+		//set by destructor of signal, awaiter suspended after it is resumed at once
+		bool _awaiters_closed = false;
+
+		std::atomic<bool> _locked{false};
+		//No main callbacks, awaiters and maintenance, see update_idle().
+		std::atomic<bool> _idle{true};
+
+		//bytes of callback arrays counted in global memory usage
+		size_t _counted_storage = 0;
+
+		explicit signal_storage(std::pmr::memory_resource* resource);
+		~signal_storage();
+
+		void update_storage_count();
+		void update_active(connection_data* connection) override;
+
+		//No connections, awaiters and maintenance: call is not counted, one word is loaded.
+		bool is_idle() const { return _idle.load(std::memory_order_relaxed); }
+		//Called by writers under _mutex after callbacks, awaiters or maintenance changed.
+		//Call sets maintenance without lock only after it found array, signal is not idle then.
+		void update_idle()
+		{
+			_idle.store(_callbacks.load(std::memory_order_relaxed) == nullptr && !_has_awaiters.load(std::memory_order_relaxed)
+				&& !_maintenance_needed.load(std::memory_order_relaxed), std::memory_order_relaxed);
+		}
+
+		//Publish joint of new connection in main callbacks or in keyed array of key.
+		void connect_joint(joint_base* jnt, slot* owner, const std::shared_ptr<connection_data>& connection, const uint64_t* key);
+		//Exchange joint of the same connection with jnt in place, false if connection is
+		//deleted, not found or made by forward_to.
+		bool replace_joint(joint_base* jnt);
+		void disconnect_all();
+		//Replace all connections with clones of rhs connections, rhs can be nullptr.
+		//Called under _mutex of both.
+		void copy_from(signal_storage* rhs);
+		bool empty() const;
+		//Usage of callbacks and connections, storage with data_size of signal data.
+		memory_usage_info memory_usage(size_t data_size) const;
+
+		//Register forward_to connection of other signal to this one.
+		void add_forwarder(const std::shared_ptr<connection_data>& forward_connection);
+		//Disconnect forwards to this signal, called by destructor of signal.
+		void disconnect_forwarders();
+		//true if from forwards to data directly or by chain, guarded by forward_graph_mutex
+		static bool is_forwarding(signal_storage* from, signal_storage* data);
+
+		static size_t hash_key(uint64_t key)
+		{
+			//Fibonacci hashing, high bits are mixed best
+			return (size_t)((key * 0x9E3779B97F4A7C15ull) >> 32);
+		}
+
+		//Lock-free lookup, nullptr if key was never connected.
+		static std::atomic<joint_array*>* find_keyed(key_index* keys, uint64_t key)
+		{
+			const size_t mask = keys->capacity - 1;
+			for (size_t i = hash_key(key) & mask;; i = (i + 1) & mask)
+			{
+				key_bucket& bucket = keys->buckets()[i];
+				if (!bucket.used.load(std::memory_order_acquire))
+					return nullptr;
+				if (bucket.key == key)
+					return &bucket.callbacks;
+			}
+		}
+
+		void end_call(unsigned epoch, bool found_deleted)
+		{
+			if (found_deleted)
+				_maintenance_needed.store(true, std::memory_order_relaxed);
+
+			//Real-time signals leave compaction to writers. This call is still counted.
+			if (_maintenance_needed.load(std::memory_order_relaxed) && !_realtime.load(std::memory_order_relaxed))
+				try_compact(1);
+
+			//Last access of data, other call or destructor of signal can free it after this.
+			//Signal destroyed during calls is released by call which ends last.
+			const uint64_t unit = call_unit(epoch);
+			if (_calls.fetch_sub(unit) == (released_bit | unit))
+				_self.reset();
+		}
+
+#ifdef LSIGNAL_COROUTINES
+		//Sequence of next awaiter, call resumes awaiters before it.
+		uint64_t awaiters_seq() const;
+		//Link awaiter, false if signal is destroyed.
+		bool link_awaiter(awaiter_node* aw);
+		//Unlink awaiter if it is still linked.
+		void remove_awaiter(awaiter_node* aw);
+		//First awaiter linked before seq_limit, unlinked.
+		awaiter_node* pop_awaiter(uint64_t seq_limit);
+		//Resume awaiters linked before seq_limit with arguments of call, args point to each of them.
+		void resume_awaiters(uint64_t seq_limit, const void* const* args);
+		//Resume awaiters with std::nullopt, awaiters suspended later are resumed at once.
+		void close_awaiters();
+		//Cleaner of awaiter added to owner.
+		std::shared_ptr<awaiter_cleaner> make_awaiter_cleaner(slot* owner);
+		//Owner disconnected: resume awaiter with std::nullopt, at once if it is suspended later.
+		static void cancel_awaiter(awaiter_cleaner* cleaner);
+#endif
+	protected:
+		void delete_deffered(int ending_calls) override;
+		void destroy_freed() override;
+	};
+
+#ifdef LSIGNAL_COROUTINES
+	struct awaiter_node
+	{
+		std::coroutine_handle<> handle;
+		//Copy arguments of signal call to awaiter, args point to each argument.
+		void (*set_value)(awaiter_node* aw, const void* const* args) = nullptr;
+		//guarded by signal_storage::_mutex
+		awaiter_node* prev = nullptr;
+		awaiter_node* next = nullptr;
+		uint64_t seq = 0;
+		bool linked = false;
+		//set by next(owner)
+		std::shared_ptr<awaiter_cleaner> cleaner;
+	};
+
+	//Cleaner of next(owner) in slot of owner. It is deleted from start, so slot don't count it as connection.
+	struct awaiter_cleaner : public connection_data
+	{
+		//guarded by signal_storage::_mutex, set while awaiter is linked
+		awaiter_node* node = nullptr;
+		bool cancelled = false;
+
+		awaiter_cleaner();
+		~awaiter_cleaner();
+	};
+#endif
+
+	//Storage with error sink of policy, shared by signals of all signatures with this policy.
+	template<exception_policy Policy>
+	struct policy_storage : public signal_storage, public error_sink_holder<Policy>
+	{
+		explicit policy_storage(std::pmr::memory_resource* resource);
+		~policy_storage();
+
+		static policy_storage* create(std::pmr::memory_resource* resource);
+		//Data of lazy signal, created by first caller, other thread can connect at the same time.
+		static policy_storage* ensure(std::atomic<policy_storage*>& data, std::pmr::memory_resource* resource);
+	};
+
+	template<exception_policy Policy>
+	policy_storage<Policy>::policy_storage(std::pmr::memory_resource* resource)
+		: signal_storage(resource)
+	{
+		count_memory(memory_kind::storage, sizeof(policy_storage) + shared_block_overhead);
+	}
+
+	template<exception_policy Policy>
+	policy_storage<Policy>::~policy_storage()
+	{
+		count_memory(memory_kind::storage, -(std::ptrdiff_t)(sizeof(policy_storage) + shared_block_overhead));
+	}
+
+	template<exception_policy Policy>
+	policy_storage<Policy>* policy_storage<Policy>::create(std::pmr::memory_resource* resource)
+	{
+		std::shared_ptr<policy_storage> data = std::allocate_shared<policy_storage>(resource_allocator<policy_storage>(resource), resource);
+		data->_self = data;
+		return data.get();
+	}
+
+	template<exception_policy Policy>
+	policy_storage<Policy>* policy_storage<Policy>::ensure(std::atomic<policy_storage*>& data, std::pmr::memory_resource* resource)
+	{
+		policy_storage* current = data.load(std::memory_order_acquire);
+		if (current != nullptr)
+			return current;
+
+		//loser free its data
+		policy_storage* created = create(resource);
+		if (data.compare_exchange_strong(current, created, std::memory_order_acq_rel))
+			return created;
+
+		created->_self.reset();
+		return current;
+	}
+
+	//Frame of signal call on current thread. Calls of chain are ended by destructor,
+	//so counters stay right when exception leaves signal call.
+	struct call_scope
+	{
+		call_frame frame;
+
+		call_scope() noexcept
+		{
+			frame.prev = current_call_frame;
+			current_call_frame = &frame;
+		}
+
+		~call_scope()
+		{
+			while (frame.depth > 0)
+			{
+				//Still in frame during end_call, so callable destroyed by its compaction can wait calls of this signal.
+				const size_t level = frame.depth - 1;
+				static_cast<signal_storage*>(frame.chain[level])->end_call(frame.epochs[level], frame.found_deleted[level]);
+				frame.depth = level;
+			}
+
+			current_call_frame = frame.prev;
+		}
 	};
 
 	// signal
-	template<typename>
-	class signal;
 
-	template<typename R, typename... Args>
-	class signal<R(Args...)>
+	template<typename R, typename... Args, exception_policy Policy>
+	class signal<R(Args...), Policy>
 	{
 	public:
 		using result_type = R;
 		using callback_type = std::function<R(Args...)>;
+		using error_sink_type = std::function<void(std::exception_ptr)>;
+		static constexpr exception_policy policy = Policy;
 
+		//Internal data is allocated by first connect (or set_lock, forward_to, next),
+		//call of never connected signal only check pointer.
 		signal();
+		//All internal allocations (callbacks, connections, storage) are made from resource.
+		//Internal data is allocated at once.
+		explicit signal(std::pmr::memory_resource* resource);
 		~signal();
 
+		//Copy use memory resource of rhs.
 		signal(const signal& rhs);
 		signal& operator= (const signal& rhs);
 
-		signal(signal&& rhs) = default;
-		signal& operator= (signal&& rhs) = default;
+		signal(signal&& rhs) noexcept;
+		signal& operator= (signal&& rhs) noexcept;
 
 		bool is_locked() const;
 		void set_lock(const bool lock);
 
+		//Signal call never take a lock. Call of real-time signal also never allocate or free memory:
+		//deleted connections are removed by writers (connect, disconnect_all, copy, compact,
+		//slots with compact signals) instead of next call. Awaiters of next() still use a lock.
+		bool is_realtime() const;
+		void set_realtime(const bool realtime);
+
+		//Remove deleted connections and free memory retired by calls in progress.
+		//For real-time signals call it periodically from non real-time thread.
+		void compact();
+
+		//Default resource if internal data is not allocated yet.
+		std::pmr::memory_resource* get_memory_resource() const;
+
 		connection connect(const callback_type& fn, slot *owner);
 		connection connect(callback_type&& fn, slot *owner);
 
+		//Any callable, stored inline in connection without std::function.
+		template<typename F, typename = std::enable_if_t<std::is_invocable_r<R, std::decay_t<F>&, Args...>::value>>
+		connection connect(F&& fn, slot *owner);
+
 		template<typename T, typename U>
 		connection connect(T *p, const U& fn, slot *owner);
 
+		//Call target with arguments of this signal. Chains of forwards are called in one loop
+		//without recursion when forward is the last called connection.
+		//Return empty connection if target already forwards to this signal (directly or by chain).
+		//Connection is disconnected when target is destroyed.
+		connection forward_to(signal& target, slot *owner);
+
+		//fn is called only if predicate(args...) is true. Predicate is stored with fn and
+		//checked by signal call before fn dispatch. Rejected connection don't change result.
+		template<typename P, typename F>
+		connection connect_filtered(P&& predicate, F&& fn, slot *owner);
+
+		//Connection called only by emit_keyed with the same key, not by signal call.
+		template<typename F>
+		connection connect_keyed(uint64_t key, F&& fn, slot *owner);
+
+		//Connection timed by profiler under label, label is copied.
+		template<typename F>
+		connection connect_labeled(const char* label, F&& fn, slot *owner);
+
 		void disconnect(const connection& connection);
 
+		//Replace callable of connection made by this signal, connection keeps its place in call
+		//order, lock and owner. Calls in progress finish with old callable, it is destroyed after
+		//them. Predicate of connect_filtered is replaced too, copies of signal keep old callable.
+		//Return false if connection is disconnected, made by forward_to or by other signal.
+		template<typename F, typename = std::enable_if_t<std::is_invocable_r<R, std::decay_t<F>&, Args...>::value>>
+		bool replace(const connection& connection, F&& fn);
+
 		void disconnect_all();
 
-		//Return last called signal result.
-		R operator() (Args... args) const;
+		//Return last called signal result. Result of callback which threw is not kept.
+		R operator() (Args... args) const noexcept(nothrow_call);
+
+		//Call signal from dispatcher::run_pending() of current thread, arguments are copied.
+		//Post is not called if signal is destroyed before.
+		void post(Args... args);
+		//Same as post(), but post of this signal pending on current thread get new arguments
+		//and keep its place in queue.
+		void post_merged(Args... args);
 
-		//this signal don`t have direct connections
+		//Call only connections made by connect_keyed with key, found by hash index.
+		//Awaiters of next() are not resumed.
+		R emit_keyed(uint64_t key, Args... args) const noexcept(nothrow_call);
+
+		//Only for catch_and_continue signal. Sink is called in thread of signal call with exception
+		//of callback or predicate, then call continues. Without sink exceptions are ignored,
+		//exception of sink leaves signal call. Copy of signal has the same sink.
+		template<exception_policy P = Policy, typename = std::enable_if_t<P == exception_policy::catch_and_continue>>
+		void set_error_sink(error_sink_type sink);
+
+		//this signal don`t have direct or keyed connections
 		bool empty() const;
+
+		//Memory used by this signal and its connections.
+		//Connection records shared between copies of signal are counted by every copy.
+		memory_usage_info memory_usage() const;
+
+		//Declared in every mode, so layout of signal data don't depend on LSIGNAL_COROUTINES.
+		class awaiter;
+
+#ifdef LSIGNAL_COROUTINES
+		//co_await sig.next() suspend coroutine until next signal call.
+		//Result is std::optional with copy of arguments, std::nullopt if signal destroyed.
+		awaiter next();
+		//Also resumed with std::nullopt when owner disconnects, like connection made with owner.
+		awaiter next(slot* owner);
+#endif
 	private:
-		struct joint
+		friend class slot;
+
+		//Joints of storage are joints of this signature.
+		using internal_data = policy_storage<Policy>;
+
+		//Longest chain called in one loop, longer chains are called by recursion.
+		static const size_t max_fused_forwards = call_frame::max_depth;
+		//Calls of no_throw signal are noexcept, call loop has no unwinding code.
+		static constexpr bool nothrow_call = Policy == exception_policy::no_throw;
+
+		struct joint : public joint_base
+		{
+			//predicate of connect_filtered, checked before call
+			bool (*filter)(const joint& jnt, Args&... args) noexcept(nothrow_call) = nullptr;
+
+			virtual R call(Args... args) const noexcept(nothrow_call) = 0;
+		};
+
+		//Clone of joint with move-only functor, it calls functor of origin.
+		struct share_tag
 		{
-			callback_type callback;
-			std::shared_ptr<connection_data> connection;
 		};
 
-		struct internal_data
+		template<typename F>
+		struct joint_impl : public joint, public functor_owners<joint_impl<F>, !std::is_copy_constructible<F>::value>
 		{
-			mutable std::mutex _mutex;
-			bool _locked = false;
-			int _signal_called_count = 0;
+			static constexpr bool shared = !std::is_copy_constructible<F>::value;
+
+			//functor lifetime is shorter than joint in block, it is destroyed by destroy()
+			//(move-only functor by destroy() of last joint sharing it), unused by clones sharing it
+			alignas(F) mutable unsigned char storage[sizeof(F)];
+
+			template<typename T>
+			joint_impl(T&& f, bool in_block);
+			joint_impl(share_tag, joint_impl* origin);
 
-			std::list<joint> _callbacks;
+			F& fn() const;
+
+			R call(Args... args) const noexcept(nothrow_call) override;
+			joint_base* clone(std::pmr::memory_resource* resource) const override;
+			void destroy(std::pmr::memory_resource* resource) override;
+			size_t size() const override;
+
+			//Free joint allocated alone.
+			void deallocate(std::pmr::memory_resource* resource);
 		};
 
-		std::shared_ptr<internal_data> _data;
+		template<typename F>
+		struct joint_block : public connection_data
+		{
+			joint_impl<F> jnt;
 
-		template<typename T, typename U, int... Ns>
-		callback_type construct_mem_fn(const T& fn, U *p, int_sequence<Ns...>) const;
+			template<typename T>
+			explicit joint_block(T&& f);
+			~joint_block();
+		};
+
+		//Fields set on joint before it is published.
+		struct joint_options
+		{
+			signal_storage* forward = nullptr;
+			bool (*filter)(const joint& jnt, Args&... args) noexcept(nothrow_call) = nullptr;
+			//connect to keyed index instead of callbacks
+			const uint64_t* key = nullptr;
+			profile_record* profile = nullptr;
+		};
+
+		//Functor of connect_filtered, predicate is read by filter without virtual call.
+		template<typename P, typename F>
+		struct filtered
+		{
+			P predicate;
+			F fn;
+
+			R operator() (Args... args);
+			static bool test(const joint& jnt, Args&... args) noexcept(nothrow_call);
+		};
+
+		//Functor of forward_to connection, hold target data until connection is freed.
+		struct forwarder
+		{
+			std::shared_ptr<signal_storage> target;
+
+			R operator() (Args... args) const noexcept(nothrow_call);
+		};
+
+		//nullptr until first connect, set once by compare exchange
+		std::atomic<internal_data*> _data{nullptr};
+
+		internal_data* get_data() const;
+		internal_data* ensure_data(std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+		//Destructor part, signal data is freed when last call or connection release it.
+		void release_data();
 
-		void copy_callbacks(const std::list<joint>& callbacks);
+		template<typename T, typename U, size_t... Ns>
+		auto construct_mem_fn(const T& fn, U *p, std::index_sequence<Ns...>) const;
 
-		std::shared_ptr<connection_data> create_connection(callback_type&& fn, slot *owner);
+		template<typename F>
+		std::shared_ptr<connection_data> create_connection(F&& fn, slot *owner, const joint_options& options = joint_options());
 
-		void delete_deffered_internal(internal_data* data) const;
+		//Pass exception of callback or predicate to error sink, catch_and_continue only.
+		static void report_error(internal_data* data, std::exception_ptr error);
 
-		void add_cleaner(slot *owner, std::shared_ptr<connection_data>& connection) const;
+		//Call signal and chain of signals it forwards to. Key select keyed connections of root.
+		//Forwarded call don't hold root, it is held by forward joint.
+		static R emit(internal_data* root, bool forwarded, const uint64_t* key, Args&... args) noexcept(nothrow_call);
+
+		//Signal call in queue of dispatcher, arena memory is reused after it.
+		struct posted_call : dispatcher::posted
+		{
+			std::shared_ptr<signal_storage> data;
+			std::tuple<std::decay_t<Args>...> values;
+
+			posted_call(std::shared_ptr<signal_storage> target, Args&... args);
+			static void invoke(dispatcher::posted* p, bool call);
+		};
 	};
 
-	template<typename R, typename... Args>
-	signal<R(Args...)>::signal()
-		: _data(std::make_shared<internal_data>())
+#ifdef LSIGNAL_COROUTINES
+	//Awaiter live in coroutine frame and linked into signal without heap allocation.
+	template<typename R, typename... Args, exception_policy Policy>
+	class signal<R(Args...), Policy>::awaiter : private awaiter_node
+	{
+		friend class signal;
+	public:
+		using value_type = std::tuple<std::decay_t<Args>...>;
+
+		awaiter(const awaiter& rhs) = delete;
+		awaiter& operator= (const awaiter& rhs) = delete;
+		~awaiter();
+
+		bool await_ready() const noexcept { return false; }
+		bool await_suspend(std::coroutine_handle<> handle);
+		std::optional<value_type> await_resume();
+	private:
+		awaiter(const std::shared_ptr<signal_storage>& data, slot* owner);
+
+		template<size_t... Ns>
+		static void set_args(awaiter_node* aw, const void* const* args, std::index_sequence<Ns...>);
+
+		std::shared_ptr<signal_storage> _data;
+		std::optional<value_type> _value;
+	};
+#endif
+
+	template<typename R, typename... Args, exception_policy Policy>
+	signal<R(Args...), Policy>::signal()
 	{
 	}
 
-	template<typename R, typename... Args>
-	signal<R(Args...)>::~signal()
+	template<typename R, typename... Args, exception_policy Policy>
+	signal<R(Args...), Policy>::signal(std::pmr::memory_resource* resource)
+		: _data(internal_data::create(resource))
 	{
 	}
 
-	template<typename R, typename... Args>
-	void signal<R(Args...)>::disconnect_all()
+	template<typename R, typename... Args, exception_policy Policy>
+	signal<R(Args...), Policy>::~signal()
 	{
-		internal_data* data = _data.get();
-		std::lock_guard<std::mutex> locker(data->_mutex);
+		release_data();
+	}
 
-		for (auto& jnt : data->_callbacks)
-		{
-			jnt.connection->deleted = true;
-		}
+	template<typename R, typename... Args, exception_policy Policy>
+	typename signal<R(Args...), Policy>::internal_data* signal<R(Args...), Policy>::get_data() const
+	{
+		return _data.load(std::memory_order_acquire);
+	}
+
+	template<typename R, typename... Args, exception_policy Policy>
+	typename signal<R(Args...), Policy>::internal_data* signal<R(Args...), Policy>::ensure_data(std::pmr::memory_resource* resource)
+	{
+		return internal_data::ensure(_data, resource);
+	}
+
+	template<typename R, typename... Args, exception_policy Policy>
+	void signal<R(Args...), Policy>::release_data()
+	{
+		if (_data.load(std::memory_order_relaxed) == nullptr)
+			return;
+
+		internal_data* data = _data.exchange(nullptr);
+		if (data == nullptr)
+			return;
+
+		data->disconnect_forwarders();
 
-		//data->_callbacks.clear(); dont clear callbacks, only mark deleted
+#ifdef LSIGNAL_COROUTINES
+		data->close_awaiters();
+#endif
+
+		//Calls in progress (callback destroyed signal or other thread) hold data, last of them release it.
+		if (data->_calls.fetch_or(signal_data_base::released_bit) == 0)
+			data->_self.reset();
 	}
 
-	template<typename R, typename... Args>
-	signal<R(Args...)>::signal(const signal& rhs)
-		: _data(std::make_shared<internal_data>())
+	template<typename R, typename... Args, exception_policy Policy>
+	void signal<R(Args...), Policy>::disconnect_all()
 	{
-		internal_data* data = _data.get();
-		internal_data* rhs_data = rhs._data.get();
+		if (internal_data* data = get_data())
+			data->disconnect_all();
+	}
+
+	template<typename R, typename... Args, exception_policy Policy>
+	signal<R(Args...), Policy>::signal(const signal& rhs)
+	{
+		internal_data* rhs_data = rhs.get_data();
+		if (rhs_data == nullptr)
+			return;
 
-		std::unique_lock<std::mutex> lock_own(data->_mutex, std::defer_lock);
-		std::unique_lock<std::mutex> lock_rhs(rhs_data->_mutex, std::defer_lock);
+		internal_data* data = ensure_data(rhs_data->_resource);
+
+		signal_data_base::write_lock lock_own(data, std::defer_lock);
+		signal_data_base::write_lock lock_rhs(rhs_data, std::defer_lock);
 
 		std::lock(lock_own, lock_rhs);
-		delete_deffered_internal(rhs_data);
 
-		data->_locked = rhs_data->_locked;
+		data->_locked.store(rhs_data->_locked.load());
+		data->_realtime.store(rhs_data->_realtime.load());
+		if constexpr (Policy == exception_policy::catch_and_continue)
+			data->_error_sink = rhs_data->_error_sink;
 
-		copy_callbacks(rhs_data->_callbacks);
+		data->copy_from(rhs_data);
 	}
 
-	template<typename R, typename... Args>
-	signal<R(Args...)>& signal<R(Args...)>::operator= (const signal& rhs)
+	template<typename R, typename... Args, exception_policy Policy>
+	signal<R(Args...), Policy>& signal<R(Args...), Policy>::operator= (const signal& rhs)
 	{
-		internal_data* data = _data.get();
-		internal_data* rhs_data = rhs._data.get();
+		internal_data* rhs_data = rhs.get_data();
+		internal_data* data = get_data();
+		if (rhs_data == data)
+			return *this;
+
+		if (rhs_data == nullptr)
+		{
+			//same as copy of never connected signal
+			signal_data_base::write_lock locker(data);
+			data->_locked.store(false);
+			data->_realtime.store(false);
+			if constexpr (Policy == exception_policy::catch_and_continue)
+				data->_error_sink = nullptr;
+			data->copy_from(nullptr);
+			return *this;
+		}
 
-		std::unique_lock<std::mutex> lock_own(data->_mutex, std::defer_lock);
-		std::unique_lock<std::mutex> lock_rhs(rhs_data->_mutex, std::defer_lock);
+		if (data == nullptr)
+			data = ensure_data(rhs_data->_resource);
+
+		signal_data_base::write_lock lock_own(data, std::defer_lock);
+		signal_data_base::write_lock lock_rhs(rhs_data, std::defer_lock);
 
 		std::lock(lock_own, lock_rhs);
-		delete_deffered_internal(rhs_data);
 
-		data->_locked = rhs_data->_locked;
+		data->_locked.store(rhs_data->_locked.load());
+		data->_realtime.store(rhs_data->_realtime.load());
+		if constexpr (Policy == exception_policy::catch_and_continue)
+			data->_error_sink = rhs_data->_error_sink;
+
+		data->copy_from(rhs_data);
+
+		return *this;
+	}
 
-		copy_callbacks(rhs_data->_callbacks);
+	template<typename R, typename... Args, exception_policy Policy>
+	signal<R(Args...), Policy>::signal(signal&& rhs) noexcept
+		: _data(rhs._data.exchange(nullptr))
+	{
+	}
+
+	template<typename R, typename... Args, exception_policy Policy>
+	signal<R(Args...), Policy>& signal<R(Args...), Policy>::operator= (signal&& rhs) noexcept
+	{
+		if (this != &rhs)
+		{
+			release_data();
+			_data.store(rhs._data.exchange(nullptr), std::memory_order_release);
+		}
 
 		return *this;
 	}
 
-	template<typename R, typename... Args>
-	bool signal<R(Args...)>::is_locked() const
+	template<typename R, typename... Args, exception_policy Policy>
+	bool signal<R(Args...), Policy>::is_locked() const
+	{
+		internal_data* data = get_data();
+		return data != nullptr && data->_locked;
+	}
+
+	template<typename R, typename... Args, exception_policy Policy>
+	void signal<R(Args...), Policy>::set_lock(const bool lock)
+	{
+		if (lock || get_data() != nullptr)
+			ensure_data()->_locked = lock;
+	}
+
+	template<typename R, typename... Args, exception_policy Policy>
+	bool signal<R(Args...), Policy>::is_realtime() const
 	{
-		return _data.get()->_locked;
+		internal_data* data = get_data();
+		return data != nullptr && data->_realtime;
 	}
 
-	template<typename R, typename... Args>
-	void signal<R(Args...)>::set_lock(const bool lock)
+	template<typename R, typename... Args, exception_policy Policy>
+	void signal<R(Args...), Policy>::set_realtime(const bool realtime)
 	{
-		_data.get()->_locked = lock;
+		if (realtime || get_data() != nullptr)
+			ensure_data()->_realtime = realtime;
 	}
 
-	template<typename R, typename... Args>
-	connection signal<R(Args...)>::connect(const callback_type& fn, slot *owner)
+	template<typename R, typename... Args, exception_policy Policy>
+	void signal<R(Args...), Policy>::compact()
 	{
-		return create_connection(static_cast<callback_type>(fn), owner);
+		if (internal_data* data = get_data())
+			data->compact();
 	}
 
-	template<typename R, typename... Args>
-	connection signal<R(Args...)>::connect(callback_type&& fn, slot *owner)
+	template<typename R, typename... Args, exception_policy Policy>
+	std::pmr::memory_resource* signal<R(Args...), Policy>::get_memory_resource() const
+	{
+		internal_data* data = get_data();
+		return data != nullptr ? data->_resource : std::pmr::get_default_resource();
+	}
+
+	template<typename R, typename... Args, exception_policy Policy>
+	connection signal<R(Args...), Policy>::connect(const callback_type& fn, slot *owner)
+	{
+		return create_connection(fn, owner);
+	}
+
+	template<typename R, typename... Args, exception_policy Policy>
+	connection signal<R(Args...), Policy>::connect(callback_type&& fn, slot *owner)
 	{
 		return create_connection(std::move(fn), owner);
 	}
 
-	template<typename R, typename... Args>
+	template<typename R, typename... Args, exception_policy Policy>
+	template<typename F, typename>
+	connection signal<R(Args...), Policy>::connect(F&& fn, slot *owner)
+	{
+		return create_connection(std::forward<F>(fn), owner);
+	}
+
+	template<typename R, typename... Args, exception_policy Policy>
 	template<typename T, typename U>
-	connection signal<R(Args...)>::connect(T *p, const U& fn, slot *owner)
+	connection signal<R(Args...), Policy>::connect(T *p, const U& fn, slot *owner)
 	{
-		auto mem_fn = std::move(construct_mem_fn(fn, p, make_int_sequence<sizeof...(Args)>{}));
+		return create_connection(construct_mem_fn(fn, p, std::index_sequence_for<Args...>{}), owner);
+	}
 
-		return create_connection(std::move(mem_fn), owner);
+	template<typename R, typename... Args, exception_policy Policy>
+	template<typename P, typename F>
+	connection signal<R(Args...), Policy>::connect_filtered(P&& predicate, F&& fn, slot *owner)
+	{
+		using filtered_type = filtered<std::decay_t<P>, std::decay_t<F>>;
+
+		joint_options options;
+		options.filter = &filtered_type::test;
+		return create_connection(filtered_type{ std::forward<P>(predicate), std::forward<F>(fn) }, owner, options);
 	}
 
-	template<typename R, typename... Args>
-	void signal<R(Args...)>::disconnect(const connection& conn)
+	template<typename R, typename... Args, exception_policy Policy>
+	template<typename F>
+	connection signal<R(Args...), Policy>::connect_keyed(uint64_t key, F&& fn, slot *owner)
+	{
+		joint_options options;
+		options.key = &key;
+		return create_connection(std::forward<F>(fn), owner, options);
+	}
+
+	template<typename R, typename... Args, exception_policy Policy>
+	template<typename F>
+	connection signal<R(Args...), Policy>::connect_labeled(const char* label, F&& fn, slot *owner)
+	{
+		joint_options options;
+		options.profile = profiler::find_record(label);
+		return create_connection(std::forward<F>(fn), owner, options);
+	}
+
+	template<typename R, typename... Args, exception_policy Policy>
+	template<typename P, typename F>
+	R signal<R(Args...), Policy>::filtered<P, F>::operator() (Args... args)
+	{
+		return fn(std::forward<Args>(args)...);
+	}
+
+	template<typename R, typename... Args, exception_policy Policy>
+	template<typename P, typename F>
+	bool signal<R(Args...), Policy>::filtered<P, F>::test(const joint& jnt, Args&... args) noexcept(nothrow_call)
+	{
+		return static_cast<const joint_impl<filtered>&>(jnt).fn().predicate(args...);
+	}
+
+	template<typename R, typename... Args, exception_policy Policy>
+	connection signal<R(Args...), Policy>::forward_to(signal& target, slot *owner)
+	{
+		internal_data* data = ensure_data();
+		internal_data* target_data = target.ensure_data();
+
+		std::lock_guard<std::mutex> graph_locker(forward_graph_mutex());
+		if (target_data == data || signal_storage::is_forwarding(target_data, data))
+			return connection();
+
+		joint_options options;
+		options.forward = target_data;
+		std::shared_ptr<connection_data> forward_connection = create_connection(forwarder{ target_data->_self }, owner, options);
+		target_data->add_forwarder(forward_connection);
+		return forward_connection;
+	}
+
+	template<typename R, typename... Args, exception_policy Policy>
+	R signal<R(Args...), Policy>::forwarder::operator() (Args... args) const noexcept(nothrow_call)
+	{
+		return emit(static_cast<internal_data*>(target.get()), true, nullptr, args...);
+	}
+
+	template<typename R, typename... Args, exception_policy Policy>
+	void signal<R(Args...), Policy>::disconnect(const connection& conn)
 	{
 		const_cast<connection*>(&conn)->disconnect();
 	}
 
-	template<typename R, typename... Args>
-	R signal<R(Args...)>::operator() (Args... args) const
+	template<typename R, typename... Args, exception_policy Policy>
+	template<typename F, typename>
+	bool signal<R(Args...), Policy>::replace(const connection& conn, F&& fn)
 	{
-		internal_data* data = _data.get();
+		internal_data* data = get_data();
+		const std::shared_ptr<connection_data>& target = conn._data;
+		if (data == nullptr || target == nullptr || target->signal_data.owner_before(data->_self) || data->_self.owner_before(target->signal_data))
+			return false;
+
+		//constructed without lock, it is user code
+		using impl_type = joint_impl<std::decay_t<F>>;
+		std::pmr::polymorphic_allocator<impl_type> allocator(data->_resource);
+		impl_type* jnt = allocator.allocate(1);
+
+		try
+		{
+			new (jnt) impl_type(std::forward<F>(fn), false);
+		}
+		catch (...)
+		{
+			allocator.deallocate(jnt, 1);
+			throw;
+		}
 
-		bool list_empty = false;
-		typename std::list<joint>::const_iterator cfirst, clast;
+		count_memory(memory_kind::callbacks, jnt->size());
+		jnt->connection = target;
+		jnt->primary = true;
 
+		bool replaced = false;
+		try
+		{
+			replaced = data->replace_joint(jnt);
+		}
+		catch (...)
 		{
-			std::lock_guard<std::mutex> locker(data->_mutex);
-			if (data->_signal_called_count == 0)
-				delete_deffered_internal(data);
+			jnt->destroy(data->_resource);
+			throw;
+		}
 
-			if (data->_locked || data->_callbacks.empty())
-				return R();
+		//not replaced callable is destroyed without lock
+		if (!replaced)
+			jnt->destroy(data->_resource);
+
+		return replaced;
+	}
 
-			data->_signal_called_count++;
 
-			cfirst = data->_callbacks.cbegin();
-			clast = data->_callbacks.cend();
-			--clast;
+	template<typename R, typename... Args, exception_policy Policy>
+	R signal<R(Args...), Policy>::operator() (Args... args) const noexcept(nothrow_call)
+	{
+		internal_data* data = get_data();
+		if (data == nullptr || data->is_idle())
+			return R();
+
+		return emit(data, false, nullptr, args...);
+	}
+
+	template<typename R, typename... Args, exception_policy Policy>
+	void signal<R(Args...), Policy>::post(Args... args)
+	{
+		internal_data* data = ensure_data();
+		void* memory = dispatcher::allocate(sizeof(posted_call), alignof(posted_call));
+		dispatcher::push(new (memory) posted_call(data->_self, args...), nullptr);
+	}
+
+	template<typename R, typename... Args, exception_policy Policy>
+	void signal<R(Args...), Policy>::post_merged(Args... args)
+	{
+		internal_data* data = ensure_data();
+		if (dispatcher::posted* pending = dispatcher::find_merged(data))
+		{
+			static_cast<posted_call*>(pending)->values = std::tuple<std::decay_t<Args>...>(std::forward<Args>(args)...);
+			return;
 		}
 
-		std::shared_ptr<internal_data> data_store(_data);
-		if constexpr (std::is_same<R, void>::value)
+		void* memory = dispatcher::allocate(sizeof(posted_call), alignof(posted_call));
+		dispatcher::push(new (memory) posted_call(data->_self, args...), data);
+	}
+
+	template<typename R, typename... Args, exception_policy Policy>
+	signal<R(Args...), Policy>::posted_call::posted_call(std::shared_ptr<signal_storage> target, Args&... args)
+		: data(std::move(target))
+		, values(std::forward<Args>(args)...)
+	{
+		run = &posted_call::invoke;
+	}
+
+	template<typename R, typename... Args, exception_policy Policy>
+	void signal<R(Args...), Policy>::posted_call::invoke(dispatcher::posted* p, bool call)
+	{
+		posted_call* self = static_cast<posted_call*>(p);
+		struct destroy_guard
 		{
-			for (auto iter = cfirst; ; ++iter)
+			posted_call* self;
+			~destroy_guard() { self->~posted_call(); }
+		} guard{ self };
+
+		//data of destroyed signal is held only by posts and calls in progress
+		if (call && (self->data->_calls.load() & signal_data_base::released_bit) == 0)
+			std::apply([self](auto&... values) { emit(static_cast<internal_data*>(self->data.get()), false, nullptr, values...); }, self->values);
+	}
+
+	template<typename R, typename... Args, exception_policy Policy>
+	R signal<R(Args...), Policy>::emit_keyed(uint64_t key, Args... args) const noexcept(nothrow_call)
+	{
+		internal_data* data = get_data();
+		if (data == nullptr)
+			return R();
+
+		return emit(data, false, &key, args...);
+	}
+
+	template<typename R, typename... Args, exception_policy Policy>
+	template<exception_policy P, typename>
+	void signal<R(Args...), Policy>::set_error_sink(error_sink_type sink)
+	{
+		internal_data* data = ensure_data();
+		std::lock_guard<std::mutex> locker(data->_mutex);
+		data->_error_sink = std::move(sink);
+	}
+
+	template<typename R, typename... Args, exception_policy Policy>
+	void signal<R(Args...), Policy>::report_error(internal_data* data, std::exception_ptr error)
+	{
+		if constexpr (Policy == exception_policy::catch_and_continue)
+		{
+			//sink is copied, it can replace itself or connect to signal
+			error_sink_type sink;
 			{
-				const joint& jnt = *iter;
+				std::lock_guard<std::mutex> locker(data->_mutex);
+				sink = data->_error_sink;
+			}
+
+			if (sink)
+				sink(error);
+		}
+	}
+
 
-				if (!jnt.connection->locked && !jnt.connection->deleted && jnt.callback)
-					jnt.callback(std::forward<Args>(args)...);
 
-				if (iter == clast)
-					break;
+	template<typename R, typename... Args, exception_policy Policy>
+	R signal<R(Args...), Policy>::emit(internal_data* root, bool forwarded, const uint64_t* key, Args&... args) noexcept(nothrow_call)
+	{
+		//Signals of chain end call after last of them, so forward joints and their targets are alive.
+		//Signal destroyed by its callback keep data until its last call ends, see end_call.
+		call_scope scope;
+		call_frame& frame = scope.frame;
+		size_t& depth = frame.depth;
+
+		internal_data* data = root;
+		std::conditional_t<std::is_void<R>::value, bool, R> r{};
+		const uint32_t sampling_period = profiler::period();
+
+		const auto invoke = [&r, sampling_period, &args...](const joint& jnt)
+		{
+			profile_scope timer(sampling_period != 0 ? jnt.sample(sampling_period) : nullptr);
+			if constexpr (std::is_void<R>::value)
+				jnt.call(std::forward<Args>(args)...);
+			else
+				r = jnt.call(std::forward<Args>(args)...);
+		};
+
+		const auto call_joint = [&invoke](internal_data* data, const joint& jnt)
+		{
+			if constexpr (Policy == exception_policy::catch_and_continue)
+			{
+				try
+				{
+					invoke(jnt);
+				}
+				catch (...)
+				{
+					report_error(data, std::current_exception());
+				}
 			}
+			else
+				invoke(jnt);
+		};
+
+		const auto accept = [&args...](internal_data* data, const joint& jnt) -> bool
+		{
+			if (jnt.filter == nullptr)
+				return true;
 
+			if constexpr (Policy == exception_policy::catch_and_continue)
 			{
-				std::lock_guard<std::mutex> locker(data->_mutex);
-				data->_signal_called_count--;
+				try
+				{
+					return jnt.filter(jnt, args...);
+				}
+				catch (...)
+				{
+					report_error(data, std::current_exception());
+					return false;
+				}
 			}
-			return;
-		} else
+			else
+				return jnt.filter(jnt, args...);
+		};
+
+		while (!data->_locked.load(std::memory_order_relaxed))
 		{
-			R r{};
-			for (auto iter = cfirst; ; ++iter)
+			//only root is called by key
+			const bool keyed = key != nullptr && depth == 0;
+
+#ifdef LSIGNAL_COROUTINES
+			const bool has_awaiters = !keyed && data->_has_awaiters.load(std::memory_order_relaxed);
+			const uint64_t awaiters_seq = has_awaiters ? data->awaiters_seq() : 0;
+#else
+			const bool has_awaiters = false;
+#endif
+
+			//No lock: while counter is not zero writers don't free arrays, indexes and joints.
+			const unsigned epoch = data->_call_epoch.load() & 1;
+			data->_calls.fetch_add(signal_data_base::call_unit(epoch));
+			joint_array* callbacks = nullptr;
+			const joint* single = nullptr;
+			if (!keyed)
+			{
+				single = static_cast<const joint*>(data->_single.load());
+				if (single == nullptr)
+					callbacks = data->_callbacks.load();
+			}
+			else if (key_index* keys = data->_keys.load())
 			{
-				const joint& jnt = *iter;
+				if (std::atomic<joint_array*>* bucket = signal_storage::find_keyed(keys, *key))
+					callbacks = bucket->load();
+			}
+
+			const size_t callbacks_count = single ? 1 : callbacks ? callbacks->size.load(std::memory_order_acquire) : 0;
+
+			frame.chain[depth] = data;
+			frame.epochs[depth] = epoch;
+			frame.found_deleted[depth] = false;
+			depth++;
 
-				if (!jnt.connection->locked && !jnt.connection->deleted && jnt.callback)
-					r = jnt.callback(std::forward<Args>(args)...);
+			if (callbacks_count == 0 && !has_awaiters)
+				break;
 
-				if (iter == clast)
-					break;
+			const std::atomic<joint_base*>* items = callbacks ? callbacks->items() : nullptr;
+			const std::atomic<uint64_t>* mask = callbacks ? callbacks->mask() : nullptr;
+			bool found_deleted = false;
+			//forward is called when next connection is found, or continue chain if it was last
+			const joint* pending_forward = nullptr;
+
+			//deleted and mask are loaded seq_cst after seq_cst increment of _calls. Pairs with
+			//disconnect_and_wait: seq_cst store of deleted, then seq_cst loads of epoch and _calls
+			//in wait_calls(). Either waiter sees this call counted and waits for it, or this call
+			//sees connection deleted. Relaxed loads give it on x86 only, not on ARM or POWER.
+			const auto visit = [&](const joint& jnt)
+			{
+				if (jnt.connection->deleted.load(std::memory_order_seq_cst))
+					found_deleted = true;
+				else if (!jnt.connection->locked.load(std::memory_order_relaxed) && jnt.callable && accept(data, jnt))
+				{
+					if (pending_forward != nullptr)
+						call_joint(data, *pending_forward);
+
+					pending_forward = nullptr;
+					if (jnt.forward != nullptr)
+						pending_forward = &jnt;
+					else
+						call_joint(data, jnt);
+				}
+			};
+
+			//Single connection is checked by its flags, mask bit is cleared only with them.
+			if (single != nullptr)
+				visit(*single);
+			else
+			{
+				for (size_t word = 0; word * 64 < callbacks_count; word++)
+				{
+					uint64_t bits = mask[word].load(std::memory_order_seq_cst);
+					if (callbacks_count - word * 64 < 64)
+						bits &= (uint64_t(1) << (callbacks_count - word * 64)) - 1;
+
+					for (; bits != 0; bits &= bits - 1)
+						visit(*static_cast<const joint*>(items[word * 64 + count_trailing_zeros(bits)].load(std::memory_order_acquire)));
+				}
 			}
 
+			frame.found_deleted[depth - 1] = found_deleted;
+
+			//awaiters are resumed after forwarded signal
+			if (pending_forward != nullptr && !has_awaiters && depth < max_fused_forwards)
 			{
-				std::lock_guard<std::mutex> locker(data->_mutex);
-				data->_signal_called_count--;
+				data = static_cast<internal_data*>(pending_forward->forward);
+				r = {};
+				continue;
 			}
-			return r;
+
+			if (pending_forward != nullptr)
+				call_joint(data, *pending_forward);
+
+#ifdef LSIGNAL_COROUTINES
+			if (has_awaiters)
+			{
+				const void* const arg_ptrs[sizeof...(Args) + 1] = { std::addressof(args)..., nullptr };
+				data->resume_awaiters(awaiters_seq, arg_ptrs);
+			}
+#endif
+			break;
 		}
+
+		if constexpr (!std::is_void<R>::value)
+			return r;
 	}
 
-	template<typename R, typename... Args>
-	template<typename T, typename U, int... Ns>
-	typename signal<R(Args...)>::callback_type signal<R(Args...)>::construct_mem_fn(const T& fn, U *p, int_sequence<Ns...>) const
+
+	template<typename R, typename... Args, exception_policy Policy>
+	template<typename T, typename U, size_t... Ns>
+	auto signal<R(Args...), Policy>::construct_mem_fn(const T& fn, U *p, std::index_sequence<Ns...>) const
 	{
 		return std::bind(fn, p, placeholder_lsignal<Ns>{}...);
 	}
 
-	template<typename R, typename... Args>
-	void signal<R(Args...)>::copy_callbacks(const std::list<joint>& callbacks)
+	template<typename R, typename... Args, exception_policy Policy>
+	void slot::disconnect_from(const signal<R(Args...), Policy>& sig)
+	{
+		if (auto* data = sig.get_data())
+			disconnect_signal(data->_self);
+	}
+
+	template<typename R, typename... Args, exception_policy Policy>
+	size_t slot::connection_count(const signal<R(Args...), Policy>& sig) const
+	{
+		auto* data = sig.get_data();
+		return data ? count_connections(data->_self) : 0;
+	}
+
+	template<typename R, typename... Args, exception_policy Policy>
+	template<typename F>
+	std::shared_ptr<connection_data> signal<R(Args...), Policy>::create_connection(F&& fn, slot *owner, const joint_options& options)
+	{
+		internal_data* data = ensure_data();
+
+		using block_type = joint_block<std::decay_t<F>>;
+		std::shared_ptr<block_type> block = std::allocate_shared<block_type>(resource_allocator<block_type>(data->_resource), std::forward<F>(fn));
+		std::shared_ptr<connection_data> connection = block;
+		connection->signal_data = data->_self;
+		connection->profile = options.profile;
+		connection->resource = data->_resource;
+
+		joint* jnt = &block->jnt;
+		jnt->connection = connection;
+		jnt->primary = true;
+		jnt->forward = options.forward;
+		jnt->filter = options.filter;
+
+		data->connect_joint(jnt, owner, connection, options.key);
+		return connection;
+	}
+
+	template<typename R, typename... Args, exception_policy Policy>
+	template<typename F>
+	template<typename T>
+	signal<R(Args...), Policy>::joint_impl<F>::joint_impl(T&& f, bool in_block)
+	{
+		this->in_block = in_block;
+		new (storage) F(std::forward<T>(f));
+
+		if constexpr (shared)
+			this->origin = this;
+
+		if constexpr (std::is_constructible<bool, const F&>::value)
+			this->callable = static_cast<bool>(fn());
+	}
+
+	template<typename R, typename... Args, exception_policy Policy>
+	template<typename F>
+	signal<R(Args...), Policy>::joint_impl<F>::joint_impl(share_tag, joint_impl* origin)
+	{
+		this->in_block = false;
+		this->callable = origin->callable;
+		this->origin = origin;
+		origin->holders.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	template<typename R, typename... Args, exception_policy Policy>
+	template<typename F>
+	F& signal<R(Args...), Policy>::joint_impl<F>::fn() const
+	{
+		if constexpr (shared)
+			return *std::launder(reinterpret_cast<F*>(this->origin->storage));
+		else
+			return *std::launder(reinterpret_cast<F*>(storage));
+	}
+
+	template<typename R, typename... Args, exception_policy Policy>
+	template<typename F>
+	R signal<R(Args...), Policy>::joint_impl<F>::call(Args... args) const noexcept(nothrow_call)
 	{
-		internal_data* data = _data.get();
-		data->_callbacks.clear();
-		for (auto iter = callbacks.begin(); iter != callbacks.end(); ++iter)
+		return fn()(std::forward<Args>(args)...);
+	}
+
+	template<typename R, typename... Args, exception_policy Policy>
+	template<typename F>
+	joint_base* signal<R(Args...), Policy>::joint_impl<F>::clone(std::pmr::memory_resource* resource) const
+	{
+		std::pmr::polymorphic_allocator<joint_impl> allocator(resource);
+		joint_impl* jnt = allocator.allocate(1);
+
+		try
 		{
-			const joint& jn = *iter;
+			if constexpr (shared)
+				new (jnt) joint_impl(share_tag(), this->origin);
+			else
+				new (jnt) joint_impl(fn(), false);
+		}
+		catch (...)
+		{
+			allocator.deallocate(jnt, 1);
+			throw;
+		}
 
-			joint jnt;
+		jnt->filter = this->filter;
+		return jnt;
+	}
 
-			jnt.callback = jn.callback;
-			jnt.connection = jn.connection;
+	template<typename R, typename... Args, exception_policy Policy>
+	template<typename F>
+	void signal<R(Args...), Policy>::joint_impl<F>::destroy(std::pmr::memory_resource* resource)
+	{
+		if constexpr (shared)
+		{
+			joint_impl* origin = this->origin;
+			if (origin->holders.fetch_sub(1, std::memory_order_acq_rel) != 1)
+			{
+				//Clones still call functor of origin, origin allocated alone is freed by last of them.
+				if (origin == this)
+				{
+					this->resource = resource;
+					std::shared_ptr<connection_data> released = std::move(this->connection);
+					return;
+				}
+			} else
+			{
+				fn().~F();
+				if (origin != this && !origin->in_block)
+					origin->deallocate(origin->resource);
+			}
+		} else
+		{
+			fn().~F();
+		}
 
-			data->_callbacks.push_back(std::move(jnt));
+		if (this->in_block)
+		{
+			//can free this joint, if no connection handles left
+			std::shared_ptr<connection_data> block = std::move(this->connection);
+			return;
 		}
+
+		deallocate(resource);
 	}
 
-	template<typename R, typename... Args>
-	void signal<R(Args...)>::add_cleaner(slot *owner, std::shared_ptr<connection_data>& connection) const
+	template<typename R, typename... Args, exception_policy Policy>
+	template<typename F>
+	void signal<R(Args...), Policy>::joint_impl<F>::deallocate(std::pmr::memory_resource* resource)
 	{
-		connection_cleaner cleaner;
-		cleaner.data = connection;
+		count_memory(memory_kind::callbacks, -(std::ptrdiff_t)size());
+		std::pmr::polymorphic_allocator<joint_impl> allocator(resource);
+		this->~joint_impl();
+		allocator.deallocate(this, 1);
+	}
 
-		if (owner != nullptr)
-			owner->_cleaners.emplace_back(cleaner);
+	template<typename R, typename... Args, exception_policy Policy>
+	template<typename F>
+	size_t signal<R(Args...), Policy>::joint_impl<F>::size() const
+	{
+		return this->in_block ? sizeof(joint_block<F>) - sizeof(connection_data) : sizeof(joint_impl);
 	}
 
-	template<typename R, typename... Args>
-	std::shared_ptr<connection_data> signal<R(Args...)>::create_connection(callback_type&& fn, slot *owner)
+	template<typename R, typename... Args, exception_policy Policy>
+	template<typename F>
+	template<typename T>
+	signal<R(Args...), Policy>::joint_block<F>::joint_block(T&& f)
+		: jnt(std::forward<T>(f), true)
 	{
-		std::shared_ptr<connection_data> connection = std::make_shared<connection_data>();
+		count_memory(memory_kind::callbacks, jnt.size());
+	}
 
-		joint jnt;
-		jnt.callback = std::move(fn);
-		jnt.connection = connection;
+	template<typename R, typename... Args, exception_policy Policy>
+	template<typename F>
+	signal<R(Args...), Policy>::joint_block<F>::~joint_block()
+	{
+		count_memory(memory_kind::callbacks, -(std::ptrdiff_t)jnt.size());
+	}
 
-		internal_data* data = _data.get();
-		std::lock_guard<std::mutex> locker(data->_mutex);
-		add_cleaner(owner, connection);
+	template<typename R, typename... Args, exception_policy Policy>
+	bool signal<R(Args...), Policy>::empty() const
+	{
+		internal_data* data = get_data();
+		return data == nullptr || data->empty();
+	}
 
-		data->_callbacks.push_back(std::move(jnt));
-		return connection;
+	template<typename R, typename... Args, exception_policy Policy>
+	memory_usage_info signal<R(Args...), Policy>::memory_usage() const
+	{
+		internal_data* data = get_data();
+		return data != nullptr ? data->memory_usage(sizeof(internal_data)) : memory_usage_info();
 	}
 
-	template<typename R, typename... Args>
-	void signal<R(Args...)>::delete_deffered_internal(internal_data* data) const
+#ifdef LSIGNAL_COROUTINES
+	template<typename R, typename... Args, exception_policy Policy>
+	typename signal<R(Args...), Policy>::awaiter signal<R(Args...), Policy>::next()
 	{
-		auto it_to_remove = std::remove_if(data->_callbacks.begin(), data->_callbacks.end(),
-			[](const joint& jnt) { return jnt.connection->deleted; }
-			);
+		return awaiter(ensure_data()->_self, nullptr);
+	}
 
-		data->_callbacks.erase(it_to_remove, data->_callbacks.end());
+	template<typename R, typename... Args, exception_policy Policy>
+	typename signal<R(Args...), Policy>::awaiter signal<R(Args...), Policy>::next(slot* owner)
+	{
+		return awaiter(ensure_data()->_self, owner);
 	}
 
-	template<typename R, typename... Args>
-	bool signal<R(Args...)>::empty() const
+	template<typename R, typename... Args, exception_policy Policy>
+	signal<R(Args...), Policy>::awaiter::awaiter(const std::shared_ptr<signal_storage>& data, slot* owner)
+		: _data(data)
 	{
-		internal_data* data = _data.get();
-		std::lock_guard<std::mutex> locker(data->_mutex);
-		return data->_callbacks.empty();
+		set_value = [](awaiter_node* aw, const void* const* args) { set_args(aw, args, std::index_sequence_for<Args...>{}); };
+		if (owner != nullptr)
+			this->cleaner = data->make_awaiter_cleaner(owner);
 	}
+
+	template<typename R, typename... Args, exception_policy Policy>
+	template<size_t... Ns>
+	void signal<R(Args...), Policy>::awaiter::set_args(awaiter_node* aw, const void* const* args, std::index_sequence<Ns...>)
+	{
+		static_cast<awaiter*>(aw)->_value.emplace(*static_cast<const std::remove_reference_t<Args>*>(args[Ns])...);
+	}
+
+	template<typename R, typename... Args, exception_policy Policy>
+	signal<R(Args...), Policy>::awaiter::~awaiter()
+	{
+		if (_data)
+			_data->remove_awaiter(this);
+	}
+
+	template<typename R, typename... Args, exception_policy Policy>
+	bool signal<R(Args...), Policy>::awaiter::await_suspend(std::coroutine_handle<> handle)
+	{
+		if (!_data)
+			return false;
+
+		//signal destroyed after next(), resumed with std::nullopt
+		this->handle = handle;
+		return _data->link_awaiter(this);
+	}
+
+	template<typename R, typename... Args, exception_policy Policy>
+	std::optional<typename signal<R(Args...), Policy>::awaiter::value_type> signal<R(Args...), Policy>::awaiter::await_resume()
+	{
+		_data.reset();
+		return std::move(_value);
+	}
+#endif
 }
+
+//Explicit instantiation. Every distinct signature is instantiated in each translation unit which use it,
+//to instantiate it once put LSIGNAL_EXTERN_SIGNAL(void(int)); in a header and
+//LSIGNAL_INSTANTIATE_SIGNAL(void(int)); in one source file. Member templates (connect of any callable)
+//are still instantiated where they are used. Layout of signal data is the same with and without
+//LSIGNAL_COROUTINES, but functions which resume awaiters differ: all translation units must agree on it,
+//build whole project with one C++ standard.
+#define LSIGNAL_EXTERN_SIGNAL(...) extern template class lsignal::signal<__VA_ARGS__>
+#define LSIGNAL_INSTANTIATE_SIGNAL(...) template class lsignal::signal<__VA_ARGS__>
+
+//Signals of common signatures instantiated in lsignal.cpp.
+//Define LSIGNAL_EXTERN_COMMON_SIGNALS for whole project to use them instead of implicit instantiation.
+#ifdef LSIGNAL_EXTERN_COMMON_SIGNALS
+LSIGNAL_EXTERN_SIGNAL(void());
+LSIGNAL_EXTERN_SIGNAL(void(bool));
+LSIGNAL_EXTERN_SIGNAL(void(int));
+LSIGNAL_EXTERN_SIGNAL(void(float));
+LSIGNAL_EXTERN_SIGNAL(void(double));
+#endif
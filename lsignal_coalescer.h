@@ -0,0 +1,284 @@
+#pragma once
+
+#include "lsignal.h"
+
+#include <atomic>
+#include <memory>
+#include <new>
+#include <thread>
+#include <chrono>
+#include <tuple>
+#include <type_traits>
+
+namespace lsignal
+{
+	// coalescer
+
+	//Accumulate bursts of emits and forward them to target signal as one call.
+	//Emits (operator()) are lock-free and can be done from any thread. Values are stored in nodes
+	//preallocated by constructor, so emit don't allocate memory (unless copy of argument does).
+	//Without merge function only the latest value is kept.
+	//flush() can be called from any thread, tick() only from one consumer thread.
+	template<typename>
+	class coalescer;
+
+	template<typename... Args>
+	class coalescer<void(Args...)>
+	{
+	public:
+		using signal_type = signal<void(Args...)>;
+		using value_type = std::tuple<std::decay_t<Args>...>;
+		using merge_type = std::function<void(value_type& accumulated, value_type&& next)>;
+		using clock = std::chrono::steady_clock;
+
+		static const size_t default_capacity = 1024;
+
+		//Capacity is count of preallocated values. Latest value mode use one node per emitting
+		//thread at most. In merge mode emit which finds all nodes pending flushes them itself.
+		explicit coalescer(signal_type& target, size_t capacity = default_capacity);
+		coalescer(signal_type& target, merge_type merge, size_t capacity = default_capacity);
+		~coalescer();
+
+		coalescer(const coalescer& rhs) = delete;
+		coalescer& operator= (const coalescer& rhs) = delete;
+
+		//Flush from emitting thread when count emits accumulated. 0 - disabled.
+		void set_flush_count(size_t count);
+		size_t flush_count() const;
+
+		//Minimal time between flushes made by tick(). zero - flush on every tick.
+		void set_flush_interval(clock::duration interval);
+		clock::duration flush_interval() const;
+
+		void operator() (Args... args);
+
+		//Call target signal with accumulated value.
+		//Return false if nothing was accumulated.
+		bool flush();
+
+		//Flush if flush interval elapsed since last flush made by tick.
+		bool tick(clock::time_point now = clock::now());
+
+		//Approximate count of accumulated emits.
+		size_t pending() const;
+
+		//Drop accumulated emits without calling target signal.
+		void clear();
+	private:
+		struct node
+		{
+			alignas(value_type) unsigned char storage[sizeof(value_type)];
+			//stack of accumulated nodes
+			node* next = nullptr;
+			//free list, index + 1 of next free node, 0 - last
+			std::atomic<uint32_t> next_free{0};
+
+			value_type& value() { return *std::launder(reinterpret_cast<value_type*>(storage)); }
+		};
+
+		signal_type& _target;
+		merge_type _merge;
+
+		//Preallocated nodes and free list of them: index + 1 in low half, change tag in high
+		//half, so popping node which was taken and returned meanwhile fails.
+		std::unique_ptr<node[]> _nodes;
+		size_t _capacity;
+		std::atomic<uint64_t> _free{0};
+
+		//Latest value mode - single node, merge mode - stack of nodes (newest first).
+		std::atomic<node*> _head{nullptr};
+		std::atomic<size_t> _pending{0};
+		std::atomic<size_t> _flush_count{0};
+
+		clock::duration _flush_interval{0};
+		clock::time_point _last_tick_flush;
+
+		//nullptr if all nodes are taken
+		node* pop_free();
+		void push_free(node* n);
+		//Destroy values and return nodes to free list.
+		void release_nodes(node* head);
+	};
+
+	template<typename... Args>
+	coalescer<void(Args...)>::coalescer(signal_type& target, size_t capacity)
+		: coalescer(target, merge_type(), capacity)
+	{
+	}
+
+	template<typename... Args>
+	coalescer<void(Args...)>::coalescer(signal_type& target, merge_type merge, size_t capacity)
+		: _target(target)
+		, _merge(std::move(merge))
+		, _nodes(new node[std::max<size_t>(capacity, 1)])
+		, _capacity(std::max<size_t>(capacity, 1))
+	{
+		for (size_t i = 0; i < _capacity; i++)
+			_nodes[i].next_free.store(i + 1 < _capacity ? (uint32_t)(i + 2) : 0, std::memory_order_relaxed);
+
+		_free.store(1, std::memory_order_release);
+	}
+
+	template<typename... Args>
+	coalescer<void(Args...)>::~coalescer()
+	{
+		release_nodes(_head.exchange(nullptr));
+	}
+
+	template<typename... Args>
+	void coalescer<void(Args...)>::set_flush_count(size_t count)
+	{
+		_flush_count.store(count, std::memory_order_relaxed);
+	}
+
+	template<typename... Args>
+	size_t coalescer<void(Args...)>::flush_count() const
+	{
+		return _flush_count.load(std::memory_order_relaxed);
+	}
+
+	template<typename... Args>
+	void coalescer<void(Args...)>::set_flush_interval(clock::duration interval)
+	{
+		_flush_interval = interval;
+	}
+
+	template<typename... Args>
+	typename coalescer<void(Args...)>::clock::duration coalescer<void(Args...)>::flush_interval() const
+	{
+		return _flush_interval;
+	}
+
+	template<typename... Args>
+	void coalescer<void(Args...)>::operator() (Args... args)
+	{
+		node* n = pop_free();
+		while (n == nullptr)
+		{
+			//all nodes are accumulated, or taken by other emits for a moment
+			if (!flush())
+				std::this_thread::yield();
+			n = pop_free();
+		}
+
+		try
+		{
+			new (n->storage) value_type(std::forward<Args>(args)...);
+		}
+		catch (...)
+		{
+			push_free(n);
+			throw;
+		}
+
+		if (_merge)
+		{
+			n->next = _head.load(std::memory_order_relaxed);
+			while (!_head.compare_exchange_weak(n->next, n, std::memory_order_release, std::memory_order_relaxed))
+				;
+		} else
+		{
+			n->next = nullptr;
+			release_nodes(_head.exchange(n, std::memory_order_acq_rel));
+		}
+
+		size_t count = _flush_count.load(std::memory_order_relaxed);
+		size_t pending = _pending.fetch_add(1, std::memory_order_relaxed) + 1;
+		if (count != 0 && pending == count)
+			flush();
+	}
+
+	template<typename... Args>
+	bool coalescer<void(Args...)>::flush()
+	{
+		node* head = _head.exchange(nullptr, std::memory_order_acquire);
+		_pending.store(0, std::memory_order_relaxed);
+
+		if (head == nullptr)
+			return false;
+
+		if (head->next != nullptr)
+		{
+			//reverse to emit order
+			node* prev = nullptr;
+			while (head)
+			{
+				node* next = head->next;
+				head->next = prev;
+				prev = head;
+				head = next;
+			}
+			head = prev;
+
+			for (node* n = head->next; n; n = n->next)
+				_merge(head->value(), std::move(n->value()));
+		}
+
+		value_type value = std::move(head->value());
+		release_nodes(head);
+
+		std::apply(_target, std::move(value));
+		return true;
+	}
+
+	template<typename... Args>
+	bool coalescer<void(Args...)>::tick(clock::time_point now)
+	{
+		if (now - _last_tick_flush < _flush_interval)
+			return false;
+
+		_last_tick_flush = now;
+		return flush();
+	}
+
+	template<typename... Args>
+	size_t coalescer<void(Args...)>::pending() const
+	{
+		return _pending.load(std::memory_order_relaxed);
+	}
+
+	template<typename... Args>
+	void coalescer<void(Args...)>::clear()
+	{
+		release_nodes(_head.exchange(nullptr, std::memory_order_acquire));
+		_pending.store(0, std::memory_order_relaxed);
+	}
+
+	template<typename... Args>
+	typename coalescer<void(Args...)>::node* coalescer<void(Args...)>::pop_free()
+	{
+		uint64_t head = _free.load(std::memory_order_acquire);
+		while ((uint32_t)head != 0)
+		{
+			node* n = &_nodes[(uint32_t)head - 1];
+			const uint64_t next = ((head >> 32) + 1) << 32 | n->next_free.load(std::memory_order_relaxed);
+			if (_free.compare_exchange_weak(head, next, std::memory_order_acquire, std::memory_order_acquire))
+				return n;
+		}
+
+		return nullptr;
+	}
+
+	template<typename... Args>
+	void coalescer<void(Args...)>::push_free(node* n)
+	{
+		const uint32_t index = (uint32_t)(n - _nodes.get()) + 1;
+		uint64_t head = _free.load(std::memory_order_relaxed);
+		do
+		{
+			n->next_free.store((uint32_t)head, std::memory_order_relaxed);
+		} while (!_free.compare_exchange_weak(head, ((head >> 32) + 1) << 32 | index, std::memory_order_release, std::memory_order_relaxed));
+	}
+
+	template<typename... Args>
+	void coalescer<void(Args...)>::release_nodes(node* head)
+	{
+		while (head)
+		{
+			node* next = head->next;
+			head->value().~value_type();
+			push_free(head);
+			head = next;
+		}
+	}
+}
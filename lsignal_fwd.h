@@ -0,0 +1,28 @@
+#pragma once
+
+//Declarations only, for headers which keep signals, connections and slots by pointer or reference.
+//Include lsignal.h where they are defined, connected or called.
+
+namespace lsignal
+{
+	struct memory_usage_info;
+	struct connection_data;
+
+	class connection;
+	class slot;
+
+	//What signal call does when callback (or predicate of connect_filtered) throws.
+	enum class exception_policy
+	{
+		//Exception leaves signal call, remaining callbacks are not called, signal stays consistent.
+		propagate,
+		//Exception is passed to error sink of signal, remaining callbacks are called.
+		catch_and_continue,
+		//Callbacks must not throw, signal call is noexcept and has no unwinding code.
+		//Exception from callback calls std::terminate.
+		no_throw
+	};
+
+	template<typename Signature, exception_policy Policy = exception_policy::propagate>
+	class signal;
+}
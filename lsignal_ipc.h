@@ -0,0 +1,546 @@
+#pragma once
+
+#include "lsignal.h"
+#include "lsignal_pack.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <climits>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+namespace lsignal
+{
+	// inter-process channel
+
+	//Ring of fixed size messages in POSIX shared memory segment, shared by all processes
+	//which open the same name. Any process can write, every subscriber reads every message.
+	//Writes are lock-free and never wait: write fails when the slowest subscriber is
+	//capacity messages behind. Subscribers of crashed processes are dropped by writers.
+	class ipc_channel
+	{
+	public:
+		static const size_t max_subscribers = 16;
+
+		//Create segment or open existing one. Capacity is rounded up to power of two,
+		//existing segment keep its capacity and must have the same message size.
+		ipc_channel(const std::string& name, size_t message_size, size_t capacity);
+		~ipc_channel();
+
+		ipc_channel(const ipc_channel& rhs) = delete;
+		ipc_channel& operator= (const ipc_channel& rhs) = delete;
+
+		bool is_open() const;
+		size_t message_size() const;
+		size_t capacity() const;
+
+		//Remove segment name, already mapped segments stay valid.
+		static bool unlink(const std::string& name);
+
+		bool write(const void* message);
+
+		//Only messages written after subscribe() are read.
+		bool subscribe();
+		void unsubscribe();
+		bool is_subscribed() const;
+
+		//Copy next message, false if there is no message. Only one thread can read.
+		bool read(void* message);
+		bool has_message() const;
+
+		//Block until message is written, wake() is called or timeout elapsed.
+		void wait(std::chrono::microseconds timeout);
+		void wake();
+	private:
+		struct subscriber
+		{
+			//0 - free, 1 - being subscribed, 2 - active
+			std::atomic<uint32_t> state;
+			std::atomic<int32_t> pid;
+			std::atomic<uint64_t> cursor;
+		};
+
+		struct header
+		{
+			std::atomic<uint32_t> ready;
+			uint32_t message_size;
+			uint64_t capacity;
+
+			alignas(64) std::atomic<uint64_t> write_pos;
+			alignas(64) std::atomic<uint32_t> notify;
+			std::atomic<uint32_t> waiters;
+			alignas(64) subscriber subscribers[max_subscribers];
+		};
+
+		struct message_slot
+		{
+			//position + 1 of message stored in slot
+			std::atomic<uint64_t> seq;
+		};
+
+		static_assert(std::atomic<uint64_t>::is_always_lock_free && std::atomic<uint32_t>::is_always_lock_free,
+			"shared memory atomics must be lock-free");
+
+		static const uint32_t ready_magic = 0x6c736967;
+
+		header* _header = nullptr;
+		size_t _mapped_size = 0;
+		size_t _slot_size = 0;
+		size_t _message_size = 0;
+		subscriber* _subscriber = nullptr;
+
+		message_slot* slot_at(uint64_t pos) const;
+		static size_t slot_size(size_t message_size);
+		static bool process_alive(int32_t pid);
+		static void futex_wait(std::atomic<uint32_t>* word, uint32_t value, std::chrono::microseconds timeout);
+		static void futex_wake(std::atomic<uint32_t>* word);
+	};
+
+	// inter-process signal
+
+	//Emit serialize trivially copyable arguments into ipc_channel.
+	//Subscribers connect to local signal, callbacks are called by dispatch()
+	//or by dispatcher thread started with start(). Process subscribe on first connect.
+	template<typename>
+	class ipc_signal;
+
+	template<typename... Args>
+	class ipc_signal<void(Args...)>
+	{
+	public:
+		using signal_type = signal<void(Args...)>;
+		using value_type = std::tuple<std::decay_t<Args>...>;
+
+		static_assert(std::conjunction<std::is_trivially_copyable<std::decay_t<Args>>...>::value,
+			"ipc_signal arguments must be trivially copyable");
+		static_assert(std::is_default_constructible<value_type>::value,
+			"ipc_signal arguments must be default constructible");
+
+		explicit ipc_signal(const std::string& name, size_t capacity = 1024);
+		~ipc_signal();
+
+		ipc_signal(const ipc_signal& rhs) = delete;
+		ipc_signal& operator= (const ipc_signal& rhs) = delete;
+
+		bool is_open() const;
+
+		//Send to all subscribed processes, false if ring is full or segment is not open.
+		bool operator() (Args... args);
+
+		//Same arguments as signal::connect.
+		template<typename... Ts>
+		connection connect(Ts&&... args);
+
+		signal_type& local();
+
+		//Call local signal for every received message, return count of messages.
+		size_t dispatch();
+
+		//Dispatcher thread spin for spin_count checks before it sleeps in wait.
+		void start(size_t spin_count = 64);
+		void stop();
+	private:
+		ipc_channel _channel;
+		signal_type _local;
+
+		std::thread _dispatcher;
+		std::atomic<bool> _running{false};
+
+		using packed = packed_args<Args...>;
+
+		static constexpr size_t message_size();
+	};
+
+	inline ipc_channel::ipc_channel(const std::string& name, size_t message_size, size_t capacity)
+		: _slot_size(slot_size(message_size))
+		, _message_size(message_size)
+	{
+		size_t rounded = 1;
+		while (rounded < capacity)
+			rounded *= 2;
+
+		bool created = true;
+		int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+		if (fd < 0 && errno == EEXIST)
+		{
+			created = false;
+			fd = shm_open(name.c_str(), O_RDWR, 0600);
+		}
+
+		if (fd < 0)
+			return;
+
+		if (created)
+		{
+			_mapped_size = sizeof(header) + rounded * _slot_size;
+			if (ftruncate(fd, (off_t)_mapped_size) != 0)
+			{
+				close(fd);
+				shm_unlink(name.c_str());
+				return;
+			}
+		} else
+		{
+			//creator can be between shm_open and ftruncate
+			struct stat st = {};
+			for (int i = 0; i < 1000; i++)
+			{
+				if (fstat(fd, &st) == 0 && st.st_size >= (off_t)sizeof(header))
+					break;
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			}
+			_mapped_size = (size_t)st.st_size;
+		}
+
+		void* mem = _mapped_size >= sizeof(header) ? mmap(nullptr, _mapped_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+		close(fd);
+		if (mem == MAP_FAILED)
+			return;
+
+		if (created)
+		{
+			header* hdr = new (mem) header();
+			hdr->message_size = (uint32_t)message_size;
+			hdr->capacity = rounded;
+			hdr->ready.store(ready_magic, std::memory_order_release);
+			_header = hdr;
+			return;
+		}
+
+		header* hdr = static_cast<header*>(mem);
+		for (int i = 0; i < 1000 && hdr->ready.load(std::memory_order_acquire) != ready_magic; i++)
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+		if (hdr->ready.load(std::memory_order_acquire) != ready_magic || hdr->message_size != message_size
+			|| sizeof(header) + hdr->capacity * _slot_size > _mapped_size)
+		{
+			munmap(mem, _mapped_size);
+			return;
+		}
+
+		_header = hdr;
+	}
+
+	inline ipc_channel::~ipc_channel()
+	{
+		unsubscribe();
+		if (_header != nullptr)
+			munmap(_header, _mapped_size);
+	}
+
+	inline bool ipc_channel::is_open() const
+	{
+		return _header != nullptr;
+	}
+
+	inline size_t ipc_channel::message_size() const
+	{
+		return _message_size;
+	}
+
+	inline size_t ipc_channel::capacity() const
+	{
+		return _header ? (size_t)_header->capacity : 0;
+	}
+
+	inline bool ipc_channel::unlink(const std::string& name)
+	{
+		return shm_unlink(name.c_str()) == 0;
+	}
+
+	inline bool ipc_channel::write(const void* message)
+	{
+		if (_header == nullptr)
+			return false;
+
+		const uint64_t capacity = _header->capacity;
+		uint64_t pos = _header->write_pos.load(std::memory_order_relaxed);
+
+		for (;;)
+		{
+			//Slot can be reused only when all subscribers read it.
+			uint64_t min_cursor = pos;
+			subscriber* slowest = nullptr;
+			for (subscriber& sub : _header->subscribers)
+			{
+				if (sub.state.load(std::memory_order_acquire) != 2)
+					continue;
+
+				uint64_t cursor = sub.cursor.load(std::memory_order_acquire);
+				if (cursor < min_cursor)
+				{
+					min_cursor = cursor;
+					slowest = &sub;
+				}
+			}
+
+			if (pos - min_cursor >= capacity)
+			{
+				if (slowest == nullptr || process_alive(slowest->pid.load(std::memory_order_relaxed)))
+					return false;
+
+				uint32_t active = 2;
+				slowest->state.compare_exchange_strong(active, 0);
+				pos = _header->write_pos.load(std::memory_order_relaxed);
+				continue;
+			}
+
+			if (_header->write_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+				break;
+		}
+
+		message_slot* slot = slot_at(pos);
+		std::memcpy(reinterpret_cast<unsigned char*>(slot + 1), message, _message_size);
+		slot->seq.store(pos + 1, std::memory_order_release);
+
+		//Read-modify-write pairs with increment in wait(): we see waiter or it sees message.
+		//No standalone fence, TSan don't model them.
+		if (_header->waiters.fetch_add(0, std::memory_order_acq_rel) != 0)
+			wake();
+
+		return true;
+	}
+
+	inline bool ipc_channel::subscribe()
+	{
+		if (_header == nullptr)
+			return false;
+
+		if (_subscriber != nullptr)
+			return true;
+
+		for (subscriber& sub : _header->subscribers)
+		{
+			uint32_t state = 0;
+			if (!sub.state.compare_exchange_strong(state, 1))
+				continue;
+
+			sub.pid.store((int32_t)getpid(), std::memory_order_relaxed);
+			sub.cursor.store(_header->write_pos.load(), std::memory_order_relaxed);
+			sub.state.store(2, std::memory_order_release);
+			_subscriber = &sub;
+			return true;
+		}
+
+		return false;
+	}
+
+	inline void ipc_channel::unsubscribe()
+	{
+		if (_subscriber == nullptr)
+			return;
+
+		_subscriber->state.store(0, std::memory_order_release);
+		_subscriber = nullptr;
+	}
+
+	inline bool ipc_channel::is_subscribed() const
+	{
+		return _subscriber != nullptr;
+	}
+
+	inline bool ipc_channel::read(void* message)
+	{
+		if (_subscriber == nullptr)
+			return false;
+
+		uint64_t pos = _subscriber->cursor.load(std::memory_order_relaxed);
+		message_slot* slot = slot_at(pos);
+		if (slot->seq.load(std::memory_order_acquire) != pos + 1)
+			return false;
+
+		std::memcpy(message, reinterpret_cast<const unsigned char*>(slot + 1), _message_size);
+		//writers don't reuse slot before cursor passed it
+		_subscriber->cursor.store(pos + 1, std::memory_order_release);
+		return true;
+	}
+
+	inline bool ipc_channel::has_message() const
+	{
+		if (_subscriber == nullptr)
+			return false;
+
+		uint64_t pos = _subscriber->cursor.load(std::memory_order_relaxed);
+		return slot_at(pos)->seq.load(std::memory_order_acquire) == pos + 1;
+	}
+
+	inline void ipc_channel::wait(std::chrono::microseconds timeout)
+	{
+		if (_header == nullptr)
+			return;
+
+		uint32_t notify = _header->notify.load(std::memory_order_acquire);
+		_header->waiters.fetch_add(1, std::memory_order_acq_rel);
+
+		if (!has_message())
+			futex_wait(&_header->notify, notify, timeout);
+
+		_header->waiters.fetch_sub(1);
+	}
+
+	inline void ipc_channel::wake()
+	{
+		if (_header == nullptr)
+			return;
+
+		_header->notify.fetch_add(1);
+		futex_wake(&_header->notify);
+	}
+
+	inline ipc_channel::message_slot* ipc_channel::slot_at(uint64_t pos) const
+	{
+		unsigned char* slots = reinterpret_cast<unsigned char*>(_header + 1);
+		return reinterpret_cast<message_slot*>(slots + (pos & (_header->capacity - 1)) * _slot_size);
+	}
+
+	inline size_t ipc_channel::slot_size(size_t message_size)
+	{
+		//slot on own cache lines, writers of neighbour slots don't share them
+		size_t size = sizeof(message_slot) + message_size;
+		return (size + 63) / 64 * 64;
+	}
+
+	inline bool ipc_channel::process_alive(int32_t pid)
+	{
+		return kill((pid_t)pid, 0) == 0 || errno != ESRCH;
+	}
+
+	inline void ipc_channel::futex_wait(std::atomic<uint32_t>* word, uint32_t value, std::chrono::microseconds timeout)
+	{
+#ifdef __linux__
+		timespec ts;
+		ts.tv_sec = (time_t)(timeout.count() / 1000000);
+		ts.tv_nsec = (long)(timeout.count() % 1000000) * 1000;
+		syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAIT, value, &ts, nullptr, 0);
+#else
+		(void)word;
+		(void)value;
+		std::this_thread::sleep_for(std::min(timeout, std::chrono::microseconds(100)));
+#endif
+	}
+
+	inline void ipc_channel::futex_wake(std::atomic<uint32_t>* word)
+	{
+#ifdef __linux__
+		syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+#else
+		(void)word;
+#endif
+	}
+
+	template<typename... Args>
+	ipc_signal<void(Args...)>::ipc_signal(const std::string& name, size_t capacity)
+		: _channel(name, message_size(), capacity)
+	{
+	}
+
+	template<typename... Args>
+	ipc_signal<void(Args...)>::~ipc_signal()
+	{
+		stop();
+	}
+
+	template<typename... Args>
+	bool ipc_signal<void(Args...)>::is_open() const
+	{
+		return _channel.is_open();
+	}
+
+	template<typename... Args>
+	bool ipc_signal<void(Args...)>::operator() (Args... args)
+	{
+		unsigned char buffer[message_size()] = {};
+		packed::pack(buffer, value_type(args...));
+		return _channel.write(buffer);
+	}
+
+	template<typename... Args>
+	template<typename... Ts>
+	connection ipc_signal<void(Args...)>::connect(Ts&&... args)
+	{
+		_channel.subscribe();
+		return _local.connect(std::forward<Ts>(args)...);
+	}
+
+	template<typename... Args>
+	typename ipc_signal<void(Args...)>::signal_type& ipc_signal<void(Args...)>::local()
+	{
+		return _local;
+	}
+
+	template<typename... Args>
+	size_t ipc_signal<void(Args...)>::dispatch()
+	{
+		unsigned char buffer[message_size()];
+		size_t count = 0;
+
+		while (_channel.read(buffer))
+		{
+			value_type values;
+			packed::unpack(buffer, values);
+			std::apply(_local, values);
+			count++;
+		}
+
+		return count;
+	}
+
+	template<typename... Args>
+	void ipc_signal<void(Args...)>::start(size_t spin_count)
+	{
+		if (_running.exchange(true))
+			return;
+
+		_channel.subscribe();
+		_dispatcher = std::thread([this, spin_count]()
+		{
+			size_t idle = 0;
+			while (_running.load(std::memory_order_relaxed))
+			{
+				if (dispatch() != 0)
+				{
+					idle = 0;
+				} else if (idle++ < spin_count)
+				{
+					std::this_thread::yield();
+				} else
+				{
+					_channel.wait(std::chrono::milliseconds(100));
+					idle = 0;
+				}
+			}
+		});
+	}
+
+	template<typename... Args>
+	void ipc_signal<void(Args...)>::stop()
+	{
+		if (!_running.exchange(false))
+			return;
+
+		//wake() wake all waiters of segment, other processes just check their ring again
+		_channel.wake();
+		_dispatcher.join();
+	}
+
+	template<typename... Args>
+	constexpr size_t ipc_signal<void(Args...)>::message_size()
+	{
+		return std::max<size_t>(1, packed::size);
+	}
+}
@@ -0,0 +1,384 @@
+#pragma once
+
+#include "lsignal.h"
+#include "lsignal_pack.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace lsignal
+{
+	// emission journal
+
+	//Record in journal file, payload follows the header.
+	//File is split into chunks, size == 0 mark the unused end of chunk.
+	struct journal_record
+	{
+		//header and payload, aligned to 8 bytes
+		uint32_t size;
+		uint32_t signal_id;
+		//steady clock, nanoseconds
+		int64_t timestamp;
+		uint32_t thread_id;
+		uint32_t payload_size;
+	};
+
+	struct journal_file_header
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint64_t chunk_size;
+		std::atomic<uint64_t> next_chunk;
+	};
+
+	//Record emits of attached signals into memory mapped append-only file.
+	//Every thread reserve its own chunk of file with one atomic operation and write records
+	//directly into mapping. Arguments must be trivially copyable.
+	//Thread keeps a chunk for each of thread_buffers recorders, recorders with the same
+	//_id % thread_buffers used alternately on one thread reserve new chunk on every switch.
+	//Recorder is a slot: destroying it disconnects it from signals.
+	//Destroy it only when attached signals are not called from other threads.
+	class journal_recorder : public slot
+	{
+	public:
+		static const uint32_t file_magic = 0x6c6a726e;
+		static const uint32_t file_version = 1;
+
+		//File is created or truncated and has fixed capacity, records which don't fit are dropped.
+		journal_recorder(const std::string& path, size_t capacity, size_t chunk_size = 64 * 1024);
+		~journal_recorder();
+
+		journal_recorder(const journal_recorder& rhs) = delete;
+		journal_recorder& operator= (const journal_recorder& rhs) = delete;
+
+		bool is_open() const;
+
+		//Record every call of sig with signal_id. Record is made by connection,
+		//so callbacks connected before attach are called before record is written.
+		template<typename... Args>
+		connection attach(signal<void(Args...)>& sig, uint32_t signal_id);
+
+		void write(uint32_t signal_id, const void* payload, uint32_t payload_size);
+
+		//Records dropped because file is full.
+		size_t dropped() const;
+		//Bytes of file reserved by threads.
+		size_t size() const;
+
+		//Write mapped pages to file.
+		void flush();
+	private:
+		static const size_t thread_buffers = 8;
+
+		struct thread_buffer
+		{
+			uint64_t owner = 0;
+			unsigned char* pos = nullptr;
+			unsigned char* end = nullptr;
+		};
+
+		journal_file_header* _header = nullptr;
+		size_t _capacity = 0;
+		size_t _chunk_size = 0;
+		int _fd = -1;
+		//unique for every recorder, so thread buffer of destroyed recorder is never reused
+		uint64_t _id;
+		std::atomic<size_t> _dropped{0};
+
+		bool reserve(thread_buffer& buffer);
+		//Buffer of this recorder on current thread.
+		thread_buffer& current_buffer() const;
+		static uint32_t current_thread_id();
+	};
+
+	//Read journal and call bound signals with recorded arguments,
+	//in timestamp order, at full speed or with original timing.
+	class journal_replayer
+	{
+	public:
+		enum class timing
+		{
+			full_speed,
+			original
+		};
+
+		explicit journal_replayer(const std::string& path);
+		~journal_replayer();
+
+		journal_replayer(const journal_replayer& rhs) = delete;
+		journal_replayer& operator= (const journal_replayer& rhs) = delete;
+
+		bool is_open() const;
+
+		//count of records in journal
+		size_t size() const;
+
+		//Records with signal_id are replayed into sig. Records of unbound signals are skipped.
+		template<typename... Args>
+		void bind(uint32_t signal_id, signal<void(Args...)>& sig);
+
+		//Return count of replayed records.
+		size_t replay(timing mode = timing::full_speed);
+	private:
+		void* _mapping = nullptr;
+		size_t _mapped_size = 0;
+		std::vector<const journal_record*> _records;
+		std::unordered_map<uint32_t, std::function<bool(const unsigned char*, uint32_t)>> _targets;
+	};
+
+	inline journal_recorder::journal_recorder(const std::string& path, size_t capacity, size_t chunk_size)
+		: _chunk_size((std::max<size_t>(chunk_size, 256) + 7) / 8 * 8)
+	{
+		static std::atomic<uint64_t> last_id{0};
+		_id = ++last_id;
+
+		//chunk 0 hold the file header
+		_capacity = std::max(capacity / _chunk_size, (size_t)2) * _chunk_size;
+
+		_fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+		if (_fd < 0)
+			return;
+
+		void* mem = MAP_FAILED;
+		if (ftruncate(_fd, (off_t)_capacity) == 0)
+			mem = mmap(nullptr, _capacity, PROT_READ | PROT_WRITE, MAP_SHARED, _fd, 0);
+
+		if (mem == MAP_FAILED)
+		{
+			close(_fd);
+			_fd = -1;
+			return;
+		}
+
+		_header = new (mem) journal_file_header();
+		_header->magic = file_magic;
+		_header->version = file_version;
+		_header->chunk_size = _chunk_size;
+		_header->next_chunk.store(1, std::memory_order_relaxed);
+	}
+
+	inline journal_recorder::~journal_recorder()
+	{
+		disconnect();
+		if (_header == nullptr)
+			return;
+
+		size_t used = std::min(size(), _capacity);
+		munmap(_header, _capacity);
+		//on failure file keep zero tail, reader skip it
+		int truncated = ftruncate(_fd, (off_t)used);
+		(void)truncated;
+		close(_fd);
+	}
+
+	inline bool journal_recorder::is_open() const
+	{
+		return _header != nullptr;
+	}
+
+	inline void journal_recorder::write(uint32_t signal_id, const void* payload, uint32_t payload_size)
+	{
+		if (_header == nullptr)
+			return;
+
+		const size_t size = (sizeof(journal_record) + payload_size + 7) / 8 * 8;
+		thread_buffer& buffer = current_buffer();
+
+		if (buffer.owner != _id || (size_t)(buffer.end - buffer.pos) < size)
+		{
+			if (size > _chunk_size || !reserve(buffer))
+			{
+				_dropped.fetch_add(1, std::memory_order_relaxed);
+				return;
+			}
+		}
+
+		journal_record* record = reinterpret_cast<journal_record*>(buffer.pos);
+		record->signal_id = signal_id;
+		record->timestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+		record->thread_id = current_thread_id();
+		record->payload_size = payload_size;
+		std::memcpy(reinterpret_cast<unsigned char*>(record + 1), payload, payload_size);
+		//size is written last, zero size is the end of chunk
+		record->size = (uint32_t)size;
+
+		buffer.pos += size;
+	}
+
+	inline size_t journal_recorder::dropped() const
+	{
+		return _dropped.load(std::memory_order_relaxed);
+	}
+
+	inline size_t journal_recorder::size() const
+	{
+		return _header ? (size_t)_header->next_chunk.load(std::memory_order_relaxed) * _chunk_size : 0;
+	}
+
+	inline void journal_recorder::flush()
+	{
+		if (_header != nullptr)
+			msync(_header, _capacity, MS_SYNC);
+	}
+
+	inline bool journal_recorder::reserve(thread_buffer& buffer)
+	{
+		uint64_t chunk = _header->next_chunk.fetch_add(1, std::memory_order_relaxed);
+		if ((chunk + 1) * _chunk_size > _capacity)
+		{
+			_header->next_chunk.store(_capacity / _chunk_size, std::memory_order_relaxed);
+			buffer.owner = 0;
+			return false;
+		}
+
+		buffer.owner = _id;
+		buffer.pos = reinterpret_cast<unsigned char*>(_header) + chunk * _chunk_size;
+		buffer.end = buffer.pos + _chunk_size;
+		return true;
+	}
+
+	inline journal_recorder::thread_buffer& journal_recorder::current_buffer() const
+	{
+		thread_local thread_buffer buffers[thread_buffers];
+		return buffers[_id % thread_buffers];
+	}
+
+	inline uint32_t journal_recorder::current_thread_id()
+	{
+		static std::atomic<uint32_t> last_thread_id{0};
+		thread_local uint32_t thread_id = ++last_thread_id;
+		return thread_id;
+	}
+
+	template<typename... Args>
+	connection journal_recorder::attach(signal<void(Args...)>& sig, uint32_t signal_id)
+	{
+		using payload = packed_args<Args...>;
+
+		return sig.connect([this, signal_id](Args... args)
+		{
+			unsigned char buffer[payload::size + 1] = {};
+			payload::pack(buffer, typename payload::value_type(args...));
+			write(signal_id, buffer, (uint32_t)payload::size);
+		}, this);
+	}
+
+	inline journal_replayer::journal_replayer(const std::string& path)
+	{
+		int fd = open(path.c_str(), O_RDONLY);
+		if (fd < 0)
+			return;
+
+		struct stat st = {};
+		if (fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(journal_file_header))
+		{
+			_mapped_size = (size_t)st.st_size;
+			_mapping = mmap(nullptr, _mapped_size, PROT_READ, MAP_PRIVATE, fd, 0);
+			if (_mapping == MAP_FAILED)
+				_mapping = nullptr;
+		}
+		close(fd);
+
+		if (_mapping == nullptr)
+			return;
+
+		const journal_file_header* header = static_cast<const journal_file_header*>(_mapping);
+		if (header->magic != journal_recorder::file_magic || header->version != journal_recorder::file_version
+			|| header->chunk_size < sizeof(journal_record))
+		{
+			munmap(_mapping, _mapped_size);
+			_mapping = nullptr;
+			return;
+		}
+
+		const unsigned char* begin = static_cast<const unsigned char*>(_mapping);
+		const size_t chunk_size = header->chunk_size;
+		for (size_t chunk = chunk_size; chunk + chunk_size <= _mapped_size; chunk += chunk_size)
+		{
+			size_t offset = 0;
+			while (offset + sizeof(journal_record) <= chunk_size)
+			{
+				const journal_record* record = reinterpret_cast<const journal_record*>(begin + chunk + offset);
+				if (record->size < sizeof(journal_record) || offset + record->size > chunk_size)
+					break;
+
+				_records.push_back(record);
+				offset += record->size;
+			}
+		}
+
+		//chunks of different threads are interleaved
+		std::stable_sort(_records.begin(), _records.end(),
+			[](const journal_record* a, const journal_record* b) { return a->timestamp < b->timestamp; });
+	}
+
+	inline journal_replayer::~journal_replayer()
+	{
+		if (_mapping != nullptr)
+			munmap(_mapping, _mapped_size);
+	}
+
+	inline bool journal_replayer::is_open() const
+	{
+		return _mapping != nullptr;
+	}
+
+	inline size_t journal_replayer::size() const
+	{
+		return _records.size();
+	}
+
+	template<typename... Args>
+	void journal_replayer::bind(uint32_t signal_id, signal<void(Args...)>& sig)
+	{
+		using payload = packed_args<Args...>;
+
+		_targets[signal_id] = [&sig](const unsigned char* data, uint32_t size)
+		{
+			if (size != payload::size)
+				return false;
+
+			typename payload::value_type values;
+			payload::unpack(data, values);
+			std::apply(sig, values);
+			return true;
+		};
+	}
+
+	inline size_t journal_replayer::replay(timing mode)
+	{
+		if (_records.empty())
+			return 0;
+
+		const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		const int64_t first = _records.front()->timestamp;
+		size_t count = 0;
+
+		for (const journal_record* record : _records)
+		{
+			auto it = _targets.find(record->signal_id);
+			if (it == _targets.end())
+				continue;
+
+			if (mode == timing::original)
+				std::this_thread::sleep_until(start + std::chrono::nanoseconds(record->timestamp - first));
+
+			if (it->second(reinterpret_cast<const unsigned char*>(record + 1), record->payload_size))
+				count++;
+		}
+
+		return count;
+	}
+}
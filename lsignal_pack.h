@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace lsignal
+{
+	// packed arguments
+
+	//Trivially copyable arguments packed one after other without padding.
+	//Message format of ipc_signal and record payload of journal_recorder.
+	template<typename... Args>
+	struct packed_args
+	{
+		using value_type = std::tuple<std::decay_t<Args>...>;
+
+		static_assert(std::conjunction<std::is_trivially_copyable<std::decay_t<Args>>...>::value,
+			"packed arguments must be trivially copyable");
+
+		static constexpr size_t size = (sizeof(std::decay_t<Args>) + ... + 0);
+
+		//Buffer has at least size bytes.
+		static void pack(unsigned char* buffer, const value_type& values);
+		static void unpack(const unsigned char* buffer, value_type& values);
+	private:
+		template<size_t... Ns>
+		static void pack(unsigned char* buffer, const value_type& values, std::index_sequence<Ns...>);
+		template<size_t... Ns>
+		static void unpack(const unsigned char* buffer, value_type& values, std::index_sequence<Ns...>);
+	};
+
+	template<typename... Args>
+	void packed_args<Args...>::pack(unsigned char* buffer, const value_type& values)
+	{
+		pack(buffer, values, std::index_sequence_for<Args...>{});
+	}
+
+	template<typename... Args>
+	void packed_args<Args...>::unpack(const unsigned char* buffer, value_type& values)
+	{
+		unpack(buffer, values, std::index_sequence_for<Args...>{});
+	}
+
+	template<typename... Args>
+	template<size_t... Ns>
+	void packed_args<Args...>::pack(unsigned char* buffer, const value_type& values, std::index_sequence<Ns...>)
+	{
+		size_t offset = 0;
+		((std::memcpy(buffer + offset, &std::get<Ns>(values), sizeof(std::get<Ns>(values))), offset += sizeof(std::get<Ns>(values))), ...);
+		(void)buffer;
+		(void)offset;
+	}
+
+	template<typename... Args>
+	template<size_t... Ns>
+	void packed_args<Args...>::unpack(const unsigned char* buffer, value_type& values, std::index_sequence<Ns...>)
+	{
+		size_t offset = 0;
+		((std::memcpy(&std::get<Ns>(values), buffer + offset, sizeof(std::get<Ns>(values))), offset += sizeof(std::get<Ns>(values))), ...);
+		(void)buffer;
+		(void)offset;
+	}
+}
@@ -0,0 +1,352 @@
+#pragma once
+
+#include "lsignal.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+
+namespace lsignal
+{
+	// single producer bridge
+
+	//How waiting side of spsc_bridge waits after spin_count checks.
+	enum class spsc_wait
+	{
+		//yield and check again, lowest latency, waiting thread keep its core
+		spin,
+		//sleep until other side publish, costs fence per publication
+		block
+	};
+
+	//Ring of argument values from one producer thread to one consumer thread which calls target signal.
+	//Values are stored in place, head and tail are on own cache lines with cached copy of other side.
+	//Producer publish head once per publish_batch emits (and by flush()), consumer publish tail
+	//once per drained batch, so cache lines are moved between cores once per batch, not per value.
+	template<typename>
+	class spsc_bridge;
+
+	template<typename... Args>
+	class spsc_bridge<void(Args...)>
+	{
+	public:
+		using signal_type = signal<void(Args...)>;
+		using value_type = std::tuple<std::decay_t<Args>...>;
+
+		//Capacity is rounded up to power of two.
+		spsc_bridge(signal_type& target, size_t capacity = 1024, size_t publish_batch = 1, spsc_wait wait = spsc_wait::spin, size_t spin_count = 64);
+		~spsc_bridge();
+
+		spsc_bridge(const spsc_bridge& rhs) = delete;
+		spsc_bridge& operator= (const spsc_bridge& rhs) = delete;
+
+		size_t capacity() const;
+
+		//Producer thread. Store arguments, false if ring is full.
+		bool try_emit(Args... args);
+		//Producer thread. Wait by wait strategy while ring is full.
+		void operator() (Args... args);
+		//Producer thread. Publish values not published by batch yet.
+		void flush();
+
+		//Consumer thread. Call target for published values, up to max_count, return count.
+		size_t drain(size_t max_count = SIZE_MAX);
+		//Consumer thread. Wait by wait strategy until value is published or timeout elapsed,
+		//false on timeout.
+		bool wait(std::chrono::microseconds timeout);
+
+		//Published values not drained yet, approximate from other threads.
+		size_t pending() const;
+
+		//Consumer thread drain ring until stop(), only one consumer: don't call drain() after start().
+		void start();
+		void stop();
+	private:
+		struct alignas(alignof(value_type)) storage
+		{
+			unsigned char bytes[sizeof(value_type)];
+		};
+
+		//Side of ring written by one thread. Other side read only the first cache line.
+		struct side
+		{
+			alignas(64) std::atomic<uint64_t> published{0};
+			//set while thread sleep in block wait
+			std::atomic<bool> sleeping{false};
+
+			//position of this thread, ahead of published
+			alignas(64) uint64_t position = 0;
+			//published position of other side seen last time
+			uint64_t other = 0;
+		};
+
+		signal_type& _target;
+		storage* _slots;
+		const uint64_t _mask;
+		const size_t _publish_batch;
+		const spsc_wait _wait;
+		const size_t _spin_count;
+
+		side _producer;
+		side _consumer;
+
+		//block wait, both sides sleep on one condition
+		std::mutex _sleep_mutex;
+		std::condition_variable _sleep_condition;
+
+		std::thread _thread;
+		std::atomic<bool> _running{false};
+
+		value_type* slot(uint64_t pos) const;
+		void publish(side& self, const side& other);
+		//Spin, then wait by wait strategy until ready() return true, timeout zero - without limit.
+		template<typename Pred>
+		bool wait_for(side& self, Pred&& ready, std::chrono::microseconds timeout);
+	};
+
+	template<typename... Args>
+	spsc_bridge<void(Args...)>::spsc_bridge(signal_type& target, size_t capacity, size_t publish_batch, spsc_wait wait, size_t spin_count)
+		: _target(target)
+		, _mask([capacity]() { uint64_t rounded = 1; while (rounded < capacity) rounded *= 2; return rounded - 1; }())
+		, _publish_batch(std::max<size_t>(1, std::min<size_t>(publish_batch, capacity)))
+		, _wait(wait)
+		, _spin_count(spin_count)
+	{
+		_slots = new storage[_mask + 1];
+	}
+
+	template<typename... Args>
+	spsc_bridge<void(Args...)>::~spsc_bridge()
+	{
+		stop();
+
+		//written values not called, published or not
+		for (uint64_t pos = _consumer.position; pos != _producer.position; pos++)
+			slot(pos)->~value_type();
+
+		delete[] _slots;
+	}
+
+	template<typename... Args>
+	size_t spsc_bridge<void(Args...)>::capacity() const
+	{
+		return (size_t)(_mask + 1);
+	}
+
+	template<typename... Args>
+	bool spsc_bridge<void(Args...)>::try_emit(Args... args)
+	{
+		const uint64_t pos = _producer.position;
+		if (pos - _producer.other > _mask)
+		{
+			//cached tail is refreshed only when ring looks full
+			_producer.other = _consumer.published.load(std::memory_order_acquire);
+			if (pos - _producer.other > _mask)
+			{
+				//consumer can't drain values which are not published
+				flush();
+				return false;
+			}
+		}
+
+		new (slot(pos)) value_type(std::forward<Args>(args)...);
+		_producer.position = pos + 1;
+
+		if (_producer.position - _producer.published.load(std::memory_order_relaxed) >= _publish_batch)
+			publish(_producer, _consumer);
+
+		return true;
+	}
+
+	template<typename... Args>
+	void spsc_bridge<void(Args...)>::operator() (Args... args)
+	{
+		while (!try_emit(args...))
+		{
+			wait_for(_producer, [this]()
+			{
+				return _producer.position - _consumer.published.load(std::memory_order_acquire) <= _mask;
+			}, std::chrono::microseconds(0));
+		}
+	}
+
+	template<typename... Args>
+	void spsc_bridge<void(Args...)>::flush()
+	{
+		if (_producer.published.load(std::memory_order_relaxed) != _producer.position)
+			publish(_producer, _consumer);
+	}
+
+	template<typename... Args>
+	size_t spsc_bridge<void(Args...)>::drain(size_t max_count)
+	{
+		size_t count = 0;
+
+		while (count < max_count)
+		{
+			if (_consumer.position == _consumer.other)
+			{
+				_consumer.other = _producer.published.load(std::memory_order_acquire);
+				if (_consumer.position == _consumer.other)
+					break;
+			}
+
+			//batch is values published at once, tail is published after it
+			const uint64_t end = _consumer.position + std::min<uint64_t>(_consumer.other - _consumer.position, max_count - count);
+			while (_consumer.position != end)
+			{
+				value_type* value = slot(_consumer.position);
+				//position moves before call, so exception of callback don't call value again
+				_consumer.position++;
+				count++;
+
+				struct destroy_guard
+				{
+					value_type* value;
+					~destroy_guard() { value->~value_type(); }
+				} guard{ value };
+
+				std::apply(_target, std::move(*value));
+			}
+
+			publish(_consumer, _producer);
+		}
+
+		return count;
+	}
+
+	template<typename... Args>
+	bool spsc_bridge<void(Args...)>::wait(std::chrono::microseconds timeout)
+	{
+		return wait_for(_consumer, [this]()
+		{
+			return _producer.published.load(std::memory_order_acquire) != _consumer.position;
+		}, timeout);
+	}
+
+	template<typename... Args>
+	size_t spsc_bridge<void(Args...)>::pending() const
+	{
+		return (size_t)(_producer.published.load(std::memory_order_acquire) - _consumer.published.load(std::memory_order_acquire));
+	}
+
+	template<typename... Args>
+	void spsc_bridge<void(Args...)>::start()
+	{
+		if (_running.exchange(true))
+			return;
+
+		_thread = std::thread([this]()
+		{
+			while (_running.load(std::memory_order_relaxed))
+			{
+				if (drain() != 0)
+					continue;
+
+				//stop() set _running before it wake sleeping thread
+				wait_for(_consumer, [this]()
+				{
+					return _producer.published.load(std::memory_order_acquire) != _consumer.position || !_running.load(std::memory_order_relaxed);
+				}, std::chrono::microseconds(0));
+			}
+
+			drain();
+		});
+	}
+
+	template<typename... Args>
+	void spsc_bridge<void(Args...)>::stop()
+	{
+		if (!_running.exchange(false))
+			return;
+
+		{
+			std::lock_guard<std::mutex> locker(_sleep_mutex);
+			_sleep_condition.notify_all();
+		}
+		_thread.join();
+	}
+
+	template<typename... Args>
+	typename spsc_bridge<void(Args...)>::value_type* spsc_bridge<void(Args...)>::slot(uint64_t pos) const
+	{
+		return reinterpret_cast<value_type*>(&_slots[pos & _mask]);
+	}
+
+	template<typename... Args>
+	void spsc_bridge<void(Args...)>::publish(side& self, const side& other)
+	{
+		if (_wait != spsc_wait::block)
+		{
+			self.published.store(self.position, std::memory_order_release);
+			return;
+		}
+
+		//Pairs with read-modify-write of published in wait_for: exchange read it (we see other side
+		//sleeping) or it read our position. No standalone fence, TSan don't model them.
+		self.published.exchange(self.position, std::memory_order_acq_rel);
+		if (other.sleeping.load(std::memory_order_acquire))
+		{
+			std::lock_guard<std::mutex> locker(_sleep_mutex);
+			_sleep_condition.notify_all();
+		}
+	}
+
+	template<typename... Args>
+	template<typename Pred>
+	bool spsc_bridge<void(Args...)>::wait_for(side& self, Pred&& ready, std::chrono::microseconds timeout)
+	{
+		for (size_t i = 0; i < _spin_count; i++)
+		{
+			if (ready())
+				return true;
+		}
+
+		const std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + timeout;
+		const auto expired = [&deadline, timeout]()
+		{
+			return timeout.count() != 0 && std::chrono::steady_clock::now() >= deadline;
+		};
+
+		if (_wait == spsc_wait::spin)
+		{
+			while (!ready())
+			{
+				if (expired())
+					return false;
+				std::this_thread::yield();
+			}
+			return true;
+		}
+
+		std::unique_lock<std::mutex> locker(_sleep_mutex);
+		self.sleeping.store(true, std::memory_order_relaxed);
+		//read latest published of other side, see publish()
+		side& other = &self == &_producer ? _consumer : _producer;
+		other.published.fetch_add(0, std::memory_order_acq_rel);
+
+		bool result = true;
+		while (!ready())
+		{
+			if (expired())
+			{
+				result = false;
+				break;
+			}
+
+			if (timeout.count() != 0)
+				_sleep_condition.wait_until(locker, deadline);
+			else
+				_sleep_condition.wait(locker);
+		}
+
+		self.sleeping.store(false, std::memory_order_relaxed);
+		return result;
+	}
+}
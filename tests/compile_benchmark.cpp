@@ -0,0 +1,75 @@
+//Compile time benchmark, not linked with tests: make compile-bench
+//Default: 500 signatures instantiated in this translation unit.
+//LSIGNAL_BENCH_EXTERN: the same signatures declared by LSIGNAL_EXTERN_SIGNAL.
+//LSIGNAL_BENCH_INCLUDE: lsignal.h included, nothing instantiated.
+//LSIGNAL_BENCH_FWD: only lsignal_fwd.h, signals passed by reference.
+//LSIGNAL_BENCH_SMALL: 20 signatures instead of 500.
+//LSIGNAL_BENCH_HEADER: path of other lsignal.h to compare with, e.g. of baseline commit.
+
+#if defined(LSIGNAL_BENCH_FWD)
+#include "../lsignal_fwd.h"
+#elif defined(LSIGNAL_BENCH_HEADER)
+#include LSIGNAL_BENCH_HEADER
+#else
+#include "../lsignal.h"
+#endif
+
+template<int N>
+struct BenchArg
+{
+	int value;
+};
+
+#define LSIGNAL_BENCH_10(M, B) M((B) * 10 + 0) M((B) * 10 + 1) M((B) * 10 + 2) M((B) * 10 + 3) M((B) * 10 + 4) \
+	M((B) * 10 + 5) M((B) * 10 + 6) M((B) * 10 + 7) M((B) * 10 + 8) M((B) * 10 + 9)
+#define LSIGNAL_BENCH_100(M, B) LSIGNAL_BENCH_10(M, (B) * 10 + 0) LSIGNAL_BENCH_10(M, (B) * 10 + 1) \
+	LSIGNAL_BENCH_10(M, (B) * 10 + 2) LSIGNAL_BENCH_10(M, (B) * 10 + 3) LSIGNAL_BENCH_10(M, (B) * 10 + 4) \
+	LSIGNAL_BENCH_10(M, (B) * 10 + 5) LSIGNAL_BENCH_10(M, (B) * 10 + 6) LSIGNAL_BENCH_10(M, (B) * 10 + 7) \
+	LSIGNAL_BENCH_10(M, (B) * 10 + 8) LSIGNAL_BENCH_10(M, (B) * 10 + 9)
+#define LSIGNAL_BENCH_500(M) LSIGNAL_BENCH_100(M, 0) LSIGNAL_BENCH_100(M, 1) LSIGNAL_BENCH_100(M, 2) \
+	LSIGNAL_BENCH_100(M, 3) LSIGNAL_BENCH_100(M, 4)
+
+#ifdef LSIGNAL_BENCH_SMALL
+#define LSIGNAL_BENCH_ALL(M) LSIGNAL_BENCH_10(M, 0) LSIGNAL_BENCH_10(M, 1)
+#else
+#define LSIGNAL_BENCH_ALL(M) LSIGNAL_BENCH_500(M)
+#endif
+
+#if defined(LSIGNAL_BENCH_FWD)
+
+template<int N>
+lsignal::signal<void(BenchArg<N>)>* UseSignal(lsignal::signal<void(BenchArg<N>)>& sig)
+{
+	return &sig;
+}
+
+#define LSIGNAL_BENCH_USE(N) template lsignal::signal<void(BenchArg<N>)>* UseSignal<N>(lsignal::signal<void(BenchArg<N>)>& sig);
+
+#elif defined(LSIGNAL_BENCH_INCLUDE)
+
+#define LSIGNAL_BENCH_USE(N)
+
+#else
+
+#ifdef LSIGNAL_BENCH_EXTERN
+#define LSIGNAL_BENCH_EXTERN_SIGNAL(N) LSIGNAL_EXTERN_SIGNAL(void(BenchArg<N>));
+LSIGNAL_BENCH_ALL(LSIGNAL_BENCH_EXTERN_SIGNAL)
+#endif
+
+//connect, call and disconnect, as typical user of signal
+template<int N>
+int UseSignal()
+{
+	int sum = 0;
+	lsignal::signal<void(BenchArg<N>)> sig;
+	lsignal::connection conn = sig.connect([&sum](BenchArg<N> arg) { sum += arg.value; }, nullptr);
+	sig(BenchArg<N>{ N });
+	sig.disconnect(conn);
+	return sum;
+}
+
+#define LSIGNAL_BENCH_USE(N) template int UseSignal<N>();
+
+#endif
+
+LSIGNAL_BENCH_ALL(LSIGNAL_BENCH_USE)
@@ -0,0 +1,14 @@
+//Signal call of one exception policy, compiled to compare generated code of policies.
+//Not linked into tests, see emit-codegen target in proj.gcc/Makefile.
+#include "../lsignal.h"
+
+#ifndef LSIGNAL_CODEGEN_POLICY
+#define LSIGNAL_CODEGEN_POLICY propagate
+#endif
+
+using codegen_signal = lsignal::signal<void(int), lsignal::exception_policy::LSIGNAL_CODEGEN_POLICY>;
+
+void codegen_emit(const codegen_signal& sig, int value)
+{
+	sig(value);
+}
@@ -0,0 +1,187 @@
+#include "tests.h"
+
+//Memory resource which count allocations and pass them to upstream.
+class CountingResource : public std::pmr::memory_resource
+{
+public:
+	explicit CountingResource(std::pmr::memory_resource* upstream = std::pmr::new_delete_resource())
+		: m_upstream(upstream)
+	{
+	}
+
+	size_t allocations = 0;
+	size_t deallocations = 0;
+	size_t bytes = 0;
+private:
+	void* do_allocate(size_t size, size_t alignment) override
+	{
+		allocations++;
+		bytes += size;
+		return m_upstream->allocate(size, alignment);
+	}
+
+	void do_deallocate(void* p, size_t size, size_t alignment) override
+	{
+		deallocations++;
+		bytes -= size;
+		m_upstream->deallocate(p, size, alignment);
+	}
+
+	bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+	{
+		return this == &other;
+	}
+
+	std::pmr::memory_resource* m_upstream;
+};
+
+void TestSignalMemoryResource()
+{
+	TestRunner::StartTest(MethodName);
+
+	size_t heap_default = HeapAllocationCount();
+	{
+		lsignal::signal<void()> sig;
+		sig.connect([]() {}, nullptr);
+	}
+	AssertHelper::VerifyValue(true, HeapAllocationCount() > heap_default, "Default resource use global heap");
+
+	static char buffer[1 << 16];
+	std::pmr::monotonic_buffer_resource arena(buffer, sizeof(buffer), std::pmr::null_memory_resource());
+	CountingResource resource(&arena);
+	int called = 0;
+
+	{
+		lsignal::signal<void(int)> sig(&resource);
+		lsignal::slot owner(&resource);
+		AssertHelper::VerifyValue(true, sig.get_memory_resource() == &resource, "Resource");
+
+		size_t heap_before = HeapAllocationCount();
+		for (int i = 0; i < 10; i++)
+			sig.connect([&called](int v) { called += v; }, &owner);
+
+		struct Receiver : public lsignal::slot
+		{
+			int value = 0;
+			void Receive(int v) { value = v; }
+		} receiver;
+		sig.connect(&receiver, &Receiver::Receive, nullptr);
+
+		sig(1);
+		AssertHelper::VerifyValue(0, (int)(HeapAllocationCount() - heap_before), "No global heap");
+		AssertHelper::VerifyValue(10, called, "Called");
+		AssertHelper::VerifyValue(1, receiver.value, "Member called");
+		AssertHelper::VerifyValue(true, resource.allocations > 11, "Allocated from resource");
+
+		heap_before = HeapAllocationCount();
+		lsignal::signal<void(int)> copy = sig;
+		lsignal::signal<void(int)> target(&resource);
+		sig.forward_to(target, nullptr);
+		AssertHelper::VerifyValue(0, (int)(HeapAllocationCount() - heap_before), "Copy and forward use no global heap");
+		AssertHelper::VerifyValue(true, copy.get_memory_resource() == &resource, "Copy use same resource");
+	}
+
+	AssertHelper::VerifyValue((int)resource.allocations, (int)resource.deallocations, "All deallocated");
+	AssertHelper::VerifyValue(0, (int)resource.bytes, "All bytes returned");
+}
+
+void TestCallWithoutHeap()
+{
+	TestRunner::StartTest(MethodName);
+
+	std::pmr::unsynchronized_pool_resource pool;
+	lsignal::signal<int(int, const std::string&)> sig(&pool);
+	lsignal::slot owner(&pool);
+
+	int sum = 0;
+	for (int i = 0; i < 100; i++)
+		sig.connect([&sum](int v, const std::string& s) { sum += v; return (int)s.size(); }, &owner);
+
+	std::string str = "string longer than small string buffer";
+
+	size_t heap_before = HeapAllocationCount();
+	int r = 0;
+	for (int i = 0; i < 1000; i++)
+		r = sig(1, str);
+
+	AssertHelper::VerifyValue(0, (int)(HeapAllocationCount() - heap_before), "Call touch global heap");
+	AssertHelper::VerifyValue(100 * 1000, sum, "Called");
+	AssertHelper::VerifyValue((int)str.size(), r, "Result");
+}
+
+void TestConnectDisconnectWithoutHeap()
+{
+	TestRunner::StartTest(MethodName);
+
+	static char buffer[1 << 20];
+	std::pmr::monotonic_buffer_resource arena(buffer, sizeof(buffer), std::pmr::null_memory_resource());
+	std::pmr::unsynchronized_pool_resource pool(&arena);
+
+	lsignal::signal<void(int)> sig(&pool);
+	int called = 0;
+
+	for (int i = 0; i < 10; i++)
+		sig.connect([&called](int) { called++; }, nullptr);
+
+	auto cycle = [&sig, &called, &pool]()
+	{
+		lsignal::slot owner(&pool);
+		lsignal::connection conn = sig.connect([&called](int) { called++; }, &owner);
+		sig.connect([&called](int) { called++; }, &owner);
+		sig(1);
+		conn.disconnect();
+		sig(2);
+	};
+
+	//warm up pool
+	for (int i = 0; i < 100; i++)
+		cycle();
+
+	size_t heap_before = HeapAllocationCount();
+	called = 0;
+	for (int i = 0; i < 1000; i++)
+		cycle();
+
+	AssertHelper::VerifyValue(0, (int)(HeapAllocationCount() - heap_before), "Connect/disconnect touch global heap");
+	AssertHelper::VerifyValue(1000 * (12 + 11), called, "Called");
+}
+
+void TestRealtimeCallWithoutAllocation()
+{
+	TestRunner::StartTest(MethodName);
+
+	CountingResource resource;
+	lsignal::signal<void(int)> sig(&resource);
+	sig.set_realtime(true);
+	int called = 0;
+
+	std::vector<lsignal::connection> connections;
+	for (int i = 0; i < 100; i++)
+		connections.push_back(sig.connect([&called](int v) { called += v; }, nullptr));
+
+	for (int i = 0; i < 100; i += 2)
+		connections[i].disconnect();
+
+	size_t allocations = resource.allocations;
+	size_t deallocations = resource.deallocations;
+	size_t heap_before = HeapAllocationCount();
+
+	for (int i = 0; i < 1000; i++)
+		sig(1);
+
+	AssertHelper::VerifyValue(0, (int)(resource.allocations - allocations), "Call allocate");
+	AssertHelper::VerifyValue(0, (int)(resource.deallocations - deallocations), "Call free");
+	AssertHelper::VerifyValue(0, (int)(HeapAllocationCount() - heap_before), "Call touch global heap");
+	AssertHelper::VerifyValue(50 * 1000, called, "Called");
+
+	sig.compact();
+	AssertHelper::VerifyValue(true, resource.deallocations > deallocations, "Freed by compact()");
+}
+
+void CallAllocatorTests()
+{
+	ExecuteTest(TestSignalMemoryResource);
+	ExecuteTest(TestCallWithoutHeap);
+	ExecuteTest(TestConnectDisconnectWithoutHeap);
+	ExecuteTest(TestRealtimeCallWithoutAllocation);
+}
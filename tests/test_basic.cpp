@@ -1,5 +1,8 @@
 #include "tests.h"
 
+#include <numeric>
+#include <stdexcept>
+
 struct SignalOwner : public lsignal::slot
 {
 };
@@ -336,6 +339,76 @@ void TestSignalSelfDelete()
 	pa->sigA(37);
 }
 
+//Signal deleted by recursive call, outer call continues, data is freed after outer call ends.
+void TestSignalDeleteInNestedCall()
+{
+	TestRunner::StartTest(MethodName);
+
+	struct Counted
+	{
+		int* destroyed;
+		Counted(int* d) : destroyed(d) {}
+		Counted(const Counted& rhs) : destroyed(rhs.destroyed) {}
+		~Counted() { (*destroyed)++; }
+		void operator()(int) const {}
+	};
+
+	lsignal::signal<void(int)>* sig = new lsignal::signal<void(int)>();
+	int destroyed = 0;
+	int calledAfter = 0;
+
+	sig->connect([&sig](int depth)
+	{
+		if (depth == 0)
+			(*sig)(1);
+		else
+		{
+			delete sig;
+			sig = nullptr;
+		}
+	}, nullptr);
+	sig->connect([&calledAfter](int) { calledAfter++; }, nullptr);
+	sig->connect(Counted(&destroyed), nullptr);
+	destroyed = 0;
+	int destroyedInCall = 0;
+	sig->connect([&destroyed, &destroyedInCall](int) { destroyedInCall += destroyed; }, nullptr);
+
+	(*sig)(0);
+
+	AssertHelper::VerifyValue(true, sig == nullptr, "Signal deleted");
+	AssertHelper::VerifyValue(2, calledAfter, "Outer and nested call continued after delete");
+	AssertHelper::VerifyValue(0, destroyedInCall, "Connections alive during calls");
+	AssertHelper::VerifyValue(1, destroyed, "Connections freed after last call");
+}
+
+//Signal deleted by other thread while call is in progress, call frees data.
+void TestSignalDeleteDuringOtherThreadCall()
+{
+	TestRunner::StartTest(MethodName);
+
+	lsignal::signal<void()>* sig = new lsignal::signal<void()>();
+	std::atomic<int> step(0);
+	std::atomic<int> calledAfter(0);
+
+	sig->connect([&step]()
+	{
+		step = 1;
+		while (step != 2)
+			std::this_thread::yield();
+	}, nullptr);
+	sig->connect([&calledAfter]() { calledAfter++; }, nullptr);
+
+	std::thread caller([sig]() { (*sig)(); });
+
+	while (step != 1)
+		std::this_thread::yield();
+	delete sig;
+	step = 2;
+	caller.join();
+
+	AssertHelper::VerifyValue(1, calledAfter.load(), "Call continued after delete");
+}
+
 void TestSignalCopy()
 {
 	TestRunner::StartTest(MethodName);
@@ -370,6 +443,48 @@ void TestSignalCopy()
 	AssertHelper::VerifyValue(true, receiverCalled, "Receiver3 should be called.");
 }
 
+void TestSignalCopyMoveOnlyCallback()
+{
+	TestRunner::StartTest(MethodName);
+
+	//counts destruction of functor, not of moved-from ones
+	struct Tracker
+	{
+		int* destroyed;
+		explicit Tracker(int* d) : destroyed(d) {}
+		Tracker(Tracker&& rhs) : destroyed(rhs.destroyed) { rhs.destroyed = nullptr; }
+		~Tracker() { if (destroyed) (*destroyed)++; }
+	};
+
+	int called = 0;
+	int destroyed = 0;
+	lsignal::signal<void(int)>* sg = new lsignal::signal<void(int)>();
+	lsignal::connection conn = sg->connect([&called, tracker = Tracker(&destroyed), value = std::make_unique<int>(5)](int v)
+	{
+		called += v * *value;
+	}, nullptr);
+
+	//copies share the functor
+	lsignal::signal<void(int)> sg2 = *sg;
+	lsignal::signal<void(int)> sg3;
+	sg3 = sg2;
+	sg2(1);
+	sg3(1);
+	AssertHelper::VerifyValue(10, called, "Copies call shared move-only functor");
+	AssertHelper::VerifyValue(0, destroyed, "Functor not copied");
+
+	delete sg;
+	sg3(1);
+	AssertHelper::VerifyValue(15, called, "Functor alive after original destroyed");
+	AssertHelper::VerifyValue(0, destroyed, "Held by copies");
+
+	conn.disconnect();
+	sg2(1);
+	sg3(1);
+	AssertHelper::VerifyValue(15, called, "Disconnected in all copies");
+	AssertHelper::VerifyValue(1, destroyed, "Destroyed by last copy");
+}
+
 void TestAddConnectionInCallback()
 {
 	TestRunner::StartTest(MethodName);
@@ -584,6 +699,39 @@ void TestRecursiveSignalAddDelete()
 	sig(33);
 
 	AssertHelper::VerifyValue(recursive_add, receiveSigACount, "Verify recursive");
+
+	delete tb;
+}
+
+void TestAddManyConnectionsInCallback()
+{
+	TestRunner::StartTest(MethodName);
+
+	lsignal::signal<void(int)> sig;
+	int added_called = 0;
+	int recursive_called = 0;
+
+	sig.connect([&sig, &added_called, &recursive_called](int depth)
+	{
+		//storage grow several times during call
+		for (int i = 0; i < 100; i++)
+			sig.connect([&added_called](int) { added_called++; }, nullptr);
+
+		recursive_called++;
+		if (depth > 0)
+			sig(depth - 1);
+	}, nullptr);
+
+	sig(2);
+	//depth 2 call nothing, depth 1 call 100 added at depth 2, depth 0 call 200
+	AssertHelper::VerifyValue(3, recursive_called, "Recursive calls");
+	AssertHelper::VerifyValue(300, added_called, "Connections added during call are called only by nested calls");
+
+	added_called = 0;
+	recursive_called = 0;
+	sig.disconnect_all();
+	sig(0);
+	AssertHelper::VerifyValue(0, added_called + recursive_called, "Disconnected");
 }
 
 void TestConnectEmptySignal()
@@ -601,6 +749,58 @@ void TestConnectEmptySignal()
 	sig_int();
 }
 
+void TestConnectionCountChanges()
+{
+	TestRunner::StartTest(MethodName);
+	lsignal::signal<int(int)> sig;
+	int called = 0;
+
+	AssertHelper::VerifyValue(0, sig(1), "Never connected");
+
+	lsignal::connection c0 = sig.connect([&called](int v) { called++; return v * 10; }, nullptr);
+	AssertHelper::VerifyValue(10, sig(1), "Single connection");
+
+	c0.set_lock(true);
+	AssertHelper::VerifyValue(0, sig(1), "Single locked connection");
+	c0.set_lock(false);
+
+	lsignal::connection c1 = sig.connect([&called](int v) { called++; return v * 20; }, nullptr);
+	AssertHelper::VerifyValue(20, sig(1), "Two connections");
+
+	c1.disconnect();
+	AssertHelper::VerifyValue(10, sig(1), "Single connection after disconnect");
+
+	c0.disconnect();
+	AssertHelper::VerifyValue(0, sig(1), "Disconnected, compacted by call");
+	AssertHelper::VerifyValue(true, sig.empty(), "Empty");
+	AssertHelper::VerifyValue(0, sig(1), "Empty call");
+
+	//memory retired by call is freed by next writer
+	lsignal::connection c2 = sig.connect([&called, &c2](int v) { called++; c2.disconnect(); return v; }, nullptr);
+	AssertHelper::VerifyValue(1, sig(1), "Disconnected in own call");
+	AssertHelper::VerifyValue(0, sig(1), "Not called after disconnect");
+	sig.connect([&called](int v) { called++; return v * 30; }, nullptr);
+	AssertHelper::VerifyValue(30, sig(1), "Connected again");
+	AssertHelper::VerifyValue(0, (int)sig.memory_usage().dead_entries, "No dead entries");
+	AssertHelper::VerifyValue(6, called, "Call count");
+
+	//single connection switched by replace, copy and compaction of several
+	lsignal::connection c3 = sig.connect([](int v) { return v * 40; }, nullptr);
+	AssertHelper::VerifyValue(40, sig(1), "Two connections again");
+	sig.disconnect_all();
+	lsignal::connection c4 = sig.connect([](int v) { return v * 50; }, nullptr);
+	AssertHelper::VerifyValue(true, sig.replace(c4, [](int v) { return v * 60; }), "Replaced");
+	AssertHelper::VerifyValue(60, sig(1), "Replaced single connection");
+
+	lsignal::signal<int(int)> copy = sig;
+	AssertHelper::VerifyValue(60, copy(1), "Single connection of copy");
+
+	for (int i = 0; i < 3; i++)
+		sig.connect([](int v) { return v; }, nullptr).disconnect();
+	sig.compact();
+	AssertHelper::VerifyValue(60, sig(1), "Single connection after compaction");
+}
+
 void TestConnectionDisconnect()
 {
 	TestRunner::StartTest(MethodName);
@@ -682,6 +882,749 @@ void TestConnectionDisconnectWithOwnerAfterSignalDelete()
 	delete owner;
 }
 
+void TestSlotCompactSignals()
+{
+	TestRunner::StartTest(MethodName);
+	lsignal::signal<void()> sig0;
+	lsignal::signal<void()> sig1;
+	int called = 0;
+
+	{
+		lsignal::slot owner;
+		for (int i = 0; i < 10; i++)
+		{
+			sig0.connect([&called]() { called++; }, &owner);
+			sig1.connect([&called]() { called++; }, &owner);
+		}
+	}
+
+	AssertHelper::VerifyValue(false, sig0.empty(), "Without compact deleted connections removed on next call");
+	sig0();
+	AssertHelper::VerifyValue(true, sig0.empty(), "Removed on call");
+
+	{
+		lsignal::slot owner;
+		owner.set_compact_signals(true);
+		for (int i = 0; i < 10; i++)
+		{
+			sig0.connect([&called]() { called++; }, &owner);
+			sig1.connect([&called]() { called++; }, &owner);
+		}
+	}
+
+	AssertHelper::VerifyValue(true, sig0.empty(), "Compacted on slot destroy");
+	AssertHelper::VerifyValue(true, sig1.empty(), "Compacted on slot destroy");
+	AssertHelper::VerifyValue(0, called, "Never called");
+}
+
+void TestSlotCompactSignalsInCallback()
+{
+	TestRunner::StartTest(MethodName);
+	lsignal::signal<void()> sig;
+	int called = 0;
+
+	lsignal::slot* owner = new lsignal::slot();
+	owner->set_compact_signals(true);
+
+	sig.connect([&owner]() { delete owner; owner = nullptr; }, nullptr);
+	for (int i = 0; i < 10; i++)
+		sig.connect([&called]() { called++; }, owner);
+
+	sig();
+	AssertHelper::VerifyValue(0, called, "Deleted during call");
+	AssertHelper::VerifyValue(false, sig.empty(), "Compaction deferred during call");
+	sig();
+	AssertHelper::VerifyValue(0, called, "Not called");
+}
+
+void TestSlotDisconnectFrom()
+{
+	TestRunner::StartTest(MethodName);
+	lsignal::signal<void()> sig0;
+	lsignal::signal<void()> sig1;
+	lsignal::signal<void()> sig2;
+	int called0 = 0;
+	int called1 = 0;
+	int called2 = 0;
+
+	lsignal::slot owner;
+	sig0.connect([&called0]() { called0++; }, &owner);
+	lsignal::connection c1 = sig1.connect([&called1]() { called1++; }, &owner);
+	AssertHelper::VerifyValue((int)(2 * sizeof(lsignal::connection_cleaner)), (int)owner.memory_usage().cleaners, "Few connections inline");
+
+	for (int i = 0; i < 3; i++)
+	{
+		sig2.connect([&called2]() { called2++; }, &owner);
+		sig0.connect([&called0]() { called0++; }, &owner);
+	}
+
+	AssertHelper::VerifyValue(8, (int)owner.connection_count(), "Connection count");
+	AssertHelper::VerifyValue(3, (int)owner.signal_count(), "Signal count");
+	AssertHelper::VerifyValue(4, (int)owner.connection_count(sig0), "Connections to signal");
+	AssertHelper::VerifyValue(1, (int)owner.connection_count(sig1), "Connections to signal");
+
+	AssertHelper::VerifyValue(8, (int)owner.connections().size(), "Enumerated");
+
+	owner.disconnect_from(sig0);
+	sig0();
+	sig1();
+	sig2();
+	AssertHelper::VerifyValue(0, called0, "Disconnected from signal");
+	AssertHelper::VerifyValue(1, called1, "Other signal connected");
+	AssertHelper::VerifyValue(3, called2, "Other signal connected");
+	AssertHelper::VerifyValue(0, (int)owner.connection_count(sig0), "No connections to signal");
+	AssertHelper::VerifyValue(2, (int)owner.signal_count(), "Signal count after disconnect_from");
+	AssertHelper::VerifyValue(true, sig0.empty(), "Signal compacted on call");
+
+	//not connected and lazy signal
+	lsignal::signal<void()> other;
+	owner.disconnect_from(other);
+	AssertHelper::VerifyValue(0, (int)owner.connection_count(other), "Not connected");
+
+	//disconnect by connection is not counted
+	c1.disconnect();
+	AssertHelper::VerifyValue(3, (int)owner.connection_count(), "Disconnected connection not counted");
+	AssertHelper::VerifyValue(1, (int)owner.signal_count(), "Signal without connections not counted");
+
+	//disconnect from signal in its own call, connections after it are not called
+	sig2.connect([&owner, &sig2]() { owner.disconnect_from(sig2); }, &owner);
+	sig2.connect([&called2]() { called2++; }, &owner);
+	sig2();
+	AssertHelper::VerifyValue(6, called2, "Disconnected in call");
+	sig2();
+	AssertHelper::VerifyValue(6, called2, "Disconnected in call");
+	AssertHelper::VerifyValue(0, (int)owner.connection_count(sig2), "No connections to signal");
+
+	//all enumerated connections of slot
+	for (int i = 0; i < 5; i++)
+		sig1.connect([]() {}, &owner);
+	for (lsignal::connection& connection : owner.connections())
+		connection.disconnect();
+	AssertHelper::VerifyValue(0, (int)owner.connection_count(), "Enumerated connections disconnected");
+
+	owner.disconnect();
+	AssertHelper::VerifyValue(0, (int)owner.connection_count(), "Slot empty");
+	AssertHelper::VerifyValue(0, (int)owner.memory_usage().total(), "Slot memory empty");
+}
+
+void TestSlotCopy()
+{
+	TestRunner::StartTest(MethodName);
+
+	struct Widget : public lsignal::slot
+	{
+		int value = 0;
+	};
+
+	lsignal::signal<void()> sig;
+	int called = 0;
+
+	Widget a;
+	a.value = 5;
+	a.set_compact_signals(true);
+	sig.connect([&called]() { called++; }, &a);
+
+	//copy starts without connections
+	Widget b = a;
+	AssertHelper::VerifyValue(5, b.value, "Copied value");
+	AssertHelper::VerifyValue(true, b.is_compact_signals(), "Copied setting");
+	AssertHelper::VerifyValue(0, (int)b.connection_count(), "Copy has no connections");
+
+	std::vector<Widget> widgets;
+	widgets.push_back(a);
+	widgets.push_back(b);
+	widgets.clear();
+	b.disconnect();
+
+	sig();
+	AssertHelper::VerifyValue(1, called, "Destroyed copies don't disconnect original");
+
+	sig.connect([&called]() { called += 10; }, &b);
+	b = a;
+	AssertHelper::VerifyValue(1, (int)b.connection_count(), "Assignment keeps own connections");
+	AssertHelper::VerifyValue(1, (int)a.connection_count(), "Assignment don't take connections");
+
+	a.disconnect();
+	sig();
+	AssertHelper::VerifyValue(11, called, "Own connection of assigned slot");
+}
+
+void TestConnectionReplace()
+{
+	TestRunner::StartTest(MethodName);
+	lsignal::signal<void(int)> sig;
+	lsignal::slot owner;
+	std::vector<int> order;
+
+	sig.connect([&order](int) { order.push_back(1); }, nullptr);
+	lsignal::connection c2 = sig.connect([&order](int) { order.push_back(2); }, &owner);
+	sig.connect([&order](int) { order.push_back(3); }, nullptr);
+
+	AssertHelper::VerifyValue(true, sig.replace(c2, [&order](int) { order.push_back(20); }), "Replaced");
+	sig(0);
+	AssertHelper::VerifyValue(true, order == std::vector<int>({ 1, 20, 3 }), "Place in call order kept");
+
+	c2.set_lock(true);
+	AssertHelper::VerifyValue(true, sig.replace(c2, [&order](int) { order.push_back(21); }), "Replaced locked");
+	order.clear();
+	sig(0);
+	AssertHelper::VerifyValue(true, order == std::vector<int>({ 1, 3 }), "Lock kept");
+	c2.set_lock(false);
+
+	//old callable destroyed after call which replaced it
+	std::shared_ptr<int> state = std::make_shared<int>(0);
+	lsignal::connection self = sig.connect([state, &sig, &self](int v)
+	{
+		if (v == 1)
+			sig.replace(self, [](int) {});
+		(*state)++;
+	}, nullptr);
+	sig(1);
+	AssertHelper::VerifyValue(1, *state, "Replaced callable finished call");
+	sig(0);
+	AssertHelper::VerifyValue(1, (int)state.use_count(), "Old callable destroyed");
+
+	lsignal::signal<void(int)> other;
+	lsignal::signal<void(int)> target;
+	lsignal::connection forward = sig.forward_to(target, nullptr);
+	AssertHelper::VerifyValue(false, other.replace(c2, [](int) {}), "Connection of other signal");
+	AssertHelper::VerifyValue(false, sig.replace(forward, [](int) {}), "Forward not replaced");
+
+	//keyed connection and owner
+	int keyed = 0;
+	lsignal::connection ck = sig.connect_keyed(7, [&keyed](int) { keyed += 1; }, &owner);
+	AssertHelper::VerifyValue(true, sig.replace(ck, [&keyed](int) { keyed += 10; }), "Replaced keyed");
+	sig.emit_keyed(7, 0);
+	AssertHelper::VerifyValue(10, keyed, "Keyed replaced");
+
+	owner.disconnect();
+	order.clear();
+	sig(0);
+	sig.emit_keyed(7, 0);
+	AssertHelper::VerifyValue(true, order == std::vector<int>({ 1, 3 }), "Replaced connection disconnected by owner");
+	AssertHelper::VerifyValue(10, keyed, "Replaced keyed connection disconnected by owner");
+	AssertHelper::VerifyValue(false, sig.replace(c2, [](int) {}), "Disconnected not replaced");
+
+	//repeated replace don't keep memory
+	lsignal::signal<void(int)> swapped;
+	lsignal::connection cs = swapped.connect([](int) {}, nullptr);
+	size_t usage = 0;
+	for (int i = 0; i < 1000; i++)
+	{
+		swapped.replace(cs, [i](int) {});
+		//retired and freed joint lists have capacity after second replace
+		if (i == 1)
+			usage = swapped.memory_usage().total();
+	}
+	AssertHelper::VerifyValue((int)usage, (int)swapped.memory_usage().total(), "Memory of replaced callables freed");
+}
+
+void TestRealtimeSignal()
+{
+	TestRunner::StartTest(MethodName);
+	lsignal::signal<void()> sig;
+	AssertHelper::VerifyValue(false, sig.is_realtime(), "Not real-time by default");
+
+	sig.set_realtime(true);
+	AssertHelper::VerifyValue(true, sig.is_realtime(), "Real-time");
+
+	int called = 0;
+	{
+		lsignal::slot owner;
+		for (int i = 0; i < 10; i++)
+			sig.connect([&called]() { called++; }, &owner);
+	}
+
+	sig();
+	AssertHelper::VerifyValue(0, called, "Deleted not called");
+	AssertHelper::VerifyValue(false, sig.empty(), "Call don't compact real-time signal");
+
+	sig.compact();
+	AssertHelper::VerifyValue(true, sig.empty(), "Compacted by compact()");
+
+	lsignal::connection conn = sig.connect([&called]() { called++; }, nullptr);
+	conn.disconnect();
+	sig();
+	sig.connect([&called]() { called++; }, nullptr);
+	AssertHelper::VerifyValue(1, (int)(sig.memory_usage().connections / lsignal::connection_data::allocated_size), "Compacted by connect");
+
+	lsignal::signal<void()> copy = sig;
+	AssertHelper::VerifyValue(true, copy.is_realtime(), "Copy is real-time");
+	copy();
+	AssertHelper::VerifyValue(1, called, "Copy called");
+}
+
+void TestActiveMask()
+{
+	TestRunner::StartTest(MethodName);
+	lsignal::signal<void(int)> sig;
+
+	//more than one mask word
+	const int count = 150;
+	std::vector<int> called(count, 0);
+	std::vector<lsignal::connection> connections;
+	for (int i = 0; i < count; i++)
+		connections.push_back(sig.connect([&called, i](int) { called[i]++; }, nullptr));
+
+	for (int i = 0; i < count; i++)
+		connections[i].set_lock(i % 10 != 0);
+
+	sig(0);
+	int sum = 0;
+	for (int i = 0; i < count; i++)
+		sum += called[i] == (i % 10 == 0 ? 1 : 0);
+	AssertHelper::VerifyValue(count, sum, "Only unlocked called");
+
+	lsignal::signal<void(int)> copy = sig;
+	connections[1].set_lock(false);
+	copy(0);
+	AssertHelper::VerifyValue(1, called[1], "Copy see unlock of original connection");
+	AssertHelper::VerifyValue(0, called[2], "Copy don't call locked");
+
+	for (int i = 0; i < count; i += 2)
+		connections[i].disconnect();
+	sig.compact();
+
+	//indexes moved by compaction
+	std::fill(called.begin(), called.end(), 0);
+	for (int i = 1; i < count; i += 2)
+		connections[i].set_lock(i % 3 != 0);
+
+	sig(0);
+	sum = 0;
+	for (int i = 0; i < count; i++)
+		sum += called[i] == (i % 2 == 1 && i % 3 == 0 ? 1 : 0);
+	AssertHelper::VerifyValue(count, sum, "Unlocked after compaction called");
+
+	for (int i = 1; i < count; i += 2)
+		connections[i].set_lock(false);
+	std::fill(called.begin(), called.end(), 0);
+	sig(0);
+	AssertHelper::VerifyValue(count / 2, (int)std::count(called.begin(), called.end(), 1), "All unlocked called");
+}
+
+void TestDisconnectInCallableDestructor()
+{
+	TestRunner::StartTest(MethodName);
+	lsignal::signal<void()> sig;
+
+	int called = 0;
+	lsignal::connection locked = sig.connect([&called]() { called++; }, nullptr);
+	lsignal::connection disconnected = sig.connect([&called]() { called++; }, nullptr);
+
+	//destroyed by compaction at end of call, while it holds signal data
+	struct Guard
+	{
+		lsignal::connection to_lock;
+		lsignal::connection to_disconnect;
+		~Guard() { to_lock.set_lock(true); to_disconnect.disconnect(); }
+	};
+	std::shared_ptr<Guard> guard = std::make_shared<Guard>();
+	guard->to_lock = locked;
+	guard->to_disconnect = disconnected;
+
+	lsignal::connection conn = sig.connect([guard]() {}, nullptr);
+	guard.reset();
+	conn.disconnect();
+
+	sig();
+	AssertHelper::VerifyValue(2, called, "Called before destructor");
+
+	called = 0;
+	sig();
+	AssertHelper::VerifyValue(0, called, "Locked and disconnected by destructor");
+	AssertHelper::VerifyValue(true, locked.is_locked(), "Locked");
+}
+
+void TestForwardTo()
+{
+	TestRunner::StartTest(MethodName);
+	lsignal::signal<void(int)> a;
+	lsignal::signal<void(int)> b;
+	std::vector<int> order;
+
+	{
+		lsignal::signal<void(int)> c;
+		a.connect([&order](int v) { order.push_back(v); }, nullptr);
+		a.forward_to(b, nullptr);
+		a.connect([&order](int v) { order.push_back(v + 1); }, nullptr);
+		b.forward_to(c, nullptr);
+		c.connect([&order](int v) { order.push_back(v + 2); }, nullptr);
+
+		a(10);
+		AssertHelper::VerifyValue(true, order == std::vector<int>({ 10, 12, 11 }), "Forward called in connection order");
+
+		//last connection of a and b, chain is called in one loop
+		order.clear();
+		lsignal::connection cd = c.forward_to(a, nullptr);
+		a.connect([&order](int v) { order.push_back(v + 3); }, nullptr).set_lock(true);
+		b(20);
+		AssertHelper::VerifyValue(true, order == std::vector<int>({ 22 }), "Cycle not connected");
+
+		b.set_lock(true);
+		order.clear();
+		a(30);
+		AssertHelper::VerifyValue(true, order == std::vector<int>({ 30, 31 }), "Locked signal don't forward");
+		b.set_lock(false);
+
+		lsignal::signal<void(int)> copy = a;
+		order.clear();
+		copy(40);
+		AssertHelper::VerifyValue(true, order == std::vector<int>({ 40, 42, 41 }), "Copy forward");
+
+		lsignal::signal<void(int)> self;
+		self.forward_to(self, nullptr);
+		self(0);
+	}
+
+	order.clear();
+	a(50);
+	AssertHelper::VerifyValue(true, order == std::vector<int>({ 50, 51 }), "Destroyed target disconnected");
+	b.compact();
+	AssertHelper::VerifyValue(true, b.empty(), "Forward to destroyed target removed");
+
+	//longer than fused chain
+	std::vector<lsignal::signal<int(int)>> chain(40);
+	lsignal::slot owner;
+	for (size_t i = 0; i + 1 < chain.size(); i++)
+		chain[i].forward_to(chain[i + 1], &owner);
+	chain.back().connect([](int v) { return v * 2; }, nullptr);
+	AssertHelper::VerifyValue(14, chain[0](7), "Result of last signal in chain");
+
+	chain[20].set_lock(true);
+	AssertHelper::VerifyValue(0, chain[0](7), "Result of locked signal");
+
+	owner.disconnect();
+	chain[20].set_lock(false);
+	AssertHelper::VerifyValue(true, chain.back().forward_to(chain[0], nullptr).is_locked() == false, "Forward after disconnect");
+}
+
+void TestDisconnectAndWaitInCallback()
+{
+	TestRunner::StartTest(MethodName);
+	lsignal::signal<void(int)> sig;
+	lsignal::signal<void(int)> target;
+	int called = 0;
+
+	lsignal::connection conn;
+	conn = sig.connect([&called, &conn](int) { called++; conn.disconnect_and_wait(); }, nullptr);
+	sig(0);
+	sig(0);
+	AssertHelper::VerifyValue(1, called, "Own call is not waited");
+
+	//call of target is in chain of sig
+	lsignal::slot owner;
+	sig.forward_to(target, nullptr);
+	target.connect([&called, &owner](int) { called++; owner.disconnect_and_wait(); }, &owner);
+	called = 0;
+	sig(0);
+	sig(0);
+	AssertHelper::VerifyValue(1, called, "Own forwarded call is not waited");
+
+	lsignal::connection recursive;
+	recursive = sig.connect([&sig, &called, &recursive](int depth)
+	{
+		called++;
+		if (depth < 3)
+			sig(depth + 1);
+		else
+			recursive.disconnect_and_wait();
+	}, nullptr);
+	called = 0;
+	sig(0);
+	sig(0);
+	AssertHelper::VerifyValue(4, called, "Recursive calls are not waited");
+}
+
+void TestExceptionPropagate()
+{
+	TestRunner::StartTest(MethodName);
+	lsignal::signal<void(int)> sig;
+	int called = 0;
+
+	lsignal::connection first = sig.connect([&called](int) { called++; }, nullptr);
+	sig.connect([](int v) { if (v == 1) throw std::runtime_error("callback"); }, nullptr);
+	sig.connect([&called](int) { called++; }, nullptr);
+
+	bool thrown = false;
+	try
+	{
+		sig(1);
+	}
+	catch (const std::runtime_error&)
+	{
+		thrown = true;
+	}
+
+	AssertHelper::VerifyValue(true, thrown, "Exception propagated");
+	AssertHelper::VerifyValue(1, called, "Remaining callbacks not called");
+	AssertHelper::VerifyValue(true, lsignal::current_call_frame == nullptr, "Call frame removed");
+
+	//call counter was released, so deleted connection is removed by next call
+	first.disconnect();
+	called = 0;
+	sig(0);
+	AssertHelper::VerifyValue(1, called, "Called after exception");
+	AssertHelper::VerifyValue(0, (int)sig.memory_usage().dead_entries, "Compacted after exception");
+}
+
+void TestExceptionCatchAndContinue()
+{
+	TestRunner::StartTest(MethodName);
+	using catch_signal = lsignal::signal<int(int), lsignal::exception_policy::catch_and_continue>;
+	catch_signal sig;
+	std::vector<std::string> errors;
+	int called = 0;
+
+	sig.connect([&called](int v) { called++; return v; }, nullptr);
+	sig.connect([](int v) -> int { throw std::runtime_error("callback"); }, nullptr);
+	sig.connect_filtered([](int v) -> bool { throw std::runtime_error("predicate"); }, [&called](int v) { called++; return v; }, nullptr);
+	sig.connect([&called](int v) { called++; return v + 1; }, nullptr);
+
+	AssertHelper::VerifyValue(2, sig(1), "Result of last called");
+	AssertHelper::VerifyValue(2, called, "Remaining callbacks called without sink");
+
+	sig.set_error_sink([&errors](std::exception_ptr error)
+	{
+		try
+		{
+			std::rethrow_exception(error);
+		}
+		catch (const std::exception& ex)
+		{
+			errors.push_back(ex.what());
+		}
+	});
+
+	called = 0;
+	AssertHelper::VerifyValue(3, sig(2), "Result of last called");
+	AssertHelper::VerifyValue(2, called, "Remaining callbacks called");
+	AssertHelper::VerifyValue(true, errors == std::vector<std::string>({ "callback", "predicate" }), "Errors passed to sink");
+
+	catch_signal copy = sig;
+	errors.clear();
+	copy(3);
+	AssertHelper::VerifyValue(2, (int)errors.size(), "Copy has sink");
+}
+
+void TestExceptionNoThrow()
+{
+	TestRunner::StartTest(MethodName);
+	lsignal::signal<void(int), lsignal::exception_policy::no_throw> sig;
+	lsignal::signal<void(int)> propagate;
+	int sum = 0;
+
+	sig.connect([&sum](int v) noexcept { sum += v; }, nullptr);
+	sig.connect_filtered([](int v) noexcept { return v > 1; }, [&sum](int v) noexcept { sum += v; }, nullptr);
+
+	sig(1);
+	sig(2);
+	AssertHelper::VerifyValue(5, sum, "Called");
+	AssertHelper::VerifyValue(true, noexcept(sig(1)), "noexcept call");
+	AssertHelper::VerifyValue(false, noexcept(propagate(1)), "Default call can throw");
+}
+
+void TestLazySignalData()
+{
+	TestRunner::StartTest(MethodName);
+	AssertHelper::VerifyValue((int)sizeof(void*), (int)sizeof(lsignal::signal<void(int)>), "Signal is one pointer");
+
+	size_t storage = lsignal::global_memory_usage().storage;
+	lsignal::signal<int(int)> sig;
+	AssertHelper::VerifyValue(0, sig(1), "Call of empty signal");
+	AssertHelper::VerifyValue(0, sig.emit_keyed(1, 1), "Keyed call of empty signal");
+	AssertHelper::VerifyValue(true, sig.empty(), "Empty");
+	AssertHelper::VerifyValue(false, sig.is_locked(), "Not locked");
+
+	sig.set_lock(false);
+	sig.set_realtime(false);
+	sig.disconnect_all();
+	sig.compact();
+	lsignal::signal<int(int)> copy = sig;
+	lsignal::signal<int(int)> moved = std::move(copy);
+	AssertHelper::VerifyValue(true, storage == lsignal::global_memory_usage().storage, "Nothing allocated");
+
+	sig.connect([](int v) { return v * 2; }, nullptr);
+	AssertHelper::VerifyValue(true, lsignal::global_memory_usage().storage > storage, "Allocated by connect");
+	AssertHelper::VerifyValue(4, sig(2), "Connected");
+
+	moved = sig;
+	AssertHelper::VerifyValue(6, moved(3), "Assigned");
+	sig = copy;
+	AssertHelper::VerifyValue(0, sig(3), "Assigned empty");
+	AssertHelper::VerifyValue(true, sig.empty(), "Empty after assign");
+
+	lsignal::signal<int(int)> locked;
+	locked.set_lock(true);
+	AssertHelper::VerifyValue(true, locked.is_locked(), "Lock allocate data");
+	locked = moved;
+	AssertHelper::VerifyValue(false, locked.is_locked(), "Lock copied");
+
+	std::vector<lsignal::signal<int(int)>> signals(3);
+	signals[1].connect([](int v) { return v; }, nullptr);
+	signals.emplace_back();
+	AssertHelper::VerifyValue(5, signals[1](5), "Moved by vector");
+}
+
+void TestFilteredConnection()
+{
+	TestRunner::StartTest(MethodName);
+	lsignal::signal<int(int)> sig;
+	int called = 0;
+
+	sig.connect([](int v) { return v; }, nullptr);
+	lsignal::connection conn = sig.connect_filtered([](int v) { return v % 2 == 0; }, [&called](int v) { called++; return v * 10; }, nullptr);
+
+	AssertHelper::VerifyValue(1, sig(1), "Rejected don't change result");
+	AssertHelper::VerifyValue(20, sig(2), "Accepted");
+	AssertHelper::VerifyValue(1, called, "Called once");
+
+	lsignal::signal<int(int)> copy = sig;
+	AssertHelper::VerifyValue(40, copy(4), "Copy keep predicate");
+	AssertHelper::VerifyValue(3, copy(3), "Copy reject");
+
+	conn.set_lock(true);
+	AssertHelper::VerifyValue(6, sig(6), "Locked");
+
+	conn.disconnect();
+	AssertHelper::VerifyValue(8, sig(8), "Disconnected");
+	AssertHelper::VerifyValue(2, called, "Called total");
+}
+
+void TestKeyedConnection()
+{
+	TestRunner::StartTest(MethodName);
+	lsignal::signal<int(int)> sig;
+	std::vector<int> called(100, 0);
+	std::vector<lsignal::connection> connections;
+
+	AssertHelper::VerifyValue(0, sig.emit_keyed(5, 1), "Nothing connected");
+
+	lsignal::slot owner;
+	for (int key = 0; key < 100; key++)
+		connections.push_back(sig.connect_keyed(key, [&called, key](int v) { called[key] += v; return key; }, key % 2 ? &owner : nullptr));
+
+	sig.connect_keyed(7, [](int v) { return v * 100; }, nullptr);
+	sig.connect([](int) { return -1; }, nullptr);
+
+	AssertHelper::VerifyValue(300, sig.emit_keyed(7, 3), "Last keyed result");
+	AssertHelper::VerifyValue(3, called[7], "Keyed called");
+	AssertHelper::VerifyValue(3, (int)std::accumulate(called.begin(), called.end(), 0), "Only key called");
+	AssertHelper::VerifyValue(-1, sig(1), "Signal call don't call keyed");
+	AssertHelper::VerifyValue(0, sig.emit_keyed(1000, 1), "Unknown key");
+
+	connections[10].set_lock(true);
+	sig.emit_keyed(10, 1);
+	AssertHelper::VerifyValue(0, called[10], "Locked");
+	connections[10].set_lock(false);
+	sig.emit_keyed(10, 1);
+	AssertHelper::VerifyValue(1, called[10], "Unlocked");
+
+	owner.disconnect();
+	connections[20].disconnect();
+	sig.compact();
+	for (int key = 0; key < 100; key++)
+		sig.emit_keyed(key, 1);
+
+	int sum = 0;
+	for (int key = 0; key < 100; key++)
+		sum += called[key] == (key % 2 == 0 && key != 20 ? 1 : 0) + (key == 10 ? 1 : 0) + (key == 7 ? 3 : 0);
+	AssertHelper::VerifyValue(100, sum, "Disconnected not called");
+
+	lsignal::signal<int(int)> copy = sig;
+	AssertHelper::VerifyValue(700, copy.emit_keyed(7, 7), "Copy keyed");
+
+	//keys without connections are dropped when index grows
+	for (int key = 1000; key < 2000; key++)
+		sig.connect_keyed(key, [](int v) { return v; }, &owner);
+	owner.disconnect();
+	sig.compact();
+	AssertHelper::VerifyValue(44, sig.emit_keyed(44, 1), "Key after growth");
+
+	sig.disconnect_all();
+	AssertHelper::VerifyValue(true, sig.empty(), "All disconnected");
+	AssertHelper::VerifyValue(false, copy.empty(), "Copy not empty");
+}
+
+void TestSignalMemoryUsage()
+{
+	TestRunner::StartTest(MethodName);
+	lsignal::signal<void()> sig;
+
+	lsignal::memory_usage_info usage = sig.memory_usage();
+	AssertHelper::VerifyValue(0, (int)usage.total(), "Internal data allocated by connect");
+
+	char big[256] = {};
+	lsignal::connection c0 = sig.connect([]() {}, nullptr);
+	sig.connect([big]() { (void)big; }, nullptr);
+	sig.connect([]() {}, nullptr);
+
+	usage = sig.memory_usage();
+	AssertHelper::VerifyValue(true, usage.storage > 0, "Internal data");
+	AssertHelper::VerifyValue(true, usage.callbacks > sizeof(big), "Functors stored inline");
+	AssertHelper::VerifyValue((int)(3 * lsignal::connection_data::allocated_size), (int)usage.connections, "Connections");
+	AssertHelper::VerifyValue(0, (int)usage.dead_entries, "No dead entries");
+
+	c0.disconnect();
+	usage = sig.memory_usage();
+	AssertHelper::VerifyValue(1, (int)usage.dead_entries, "Dead entry until call");
+	AssertHelper::VerifyValue(true, usage.dead_bytes > 0, "Dead bytes");
+
+	sig();
+	usage = sig.memory_usage();
+	AssertHelper::VerifyValue(0, (int)usage.dead_entries, "Dead entry removed by call");
+	AssertHelper::VerifyValue((int)(2 * lsignal::connection_data::allocated_size), (int)usage.connections, "Connections after call");
+}
+
+void TestSlotMemoryUsage()
+{
+	TestRunner::StartTest(MethodName);
+	lsignal::signal<void()> sig;
+	lsignal::slot owner;
+
+	lsignal::connection c0 = sig.connect([]() {}, &owner);
+	sig.connect([]() {}, &owner);
+
+	lsignal::memory_usage_info usage = owner.memory_usage();
+	AssertHelper::VerifyValue(true, usage.cleaners >= 2 * sizeof(lsignal::connection_cleaner), "Cleaners");
+	AssertHelper::VerifyValue(0, (int)usage.dead_entries, "No dead entries");
+
+	c0.disconnect();
+	sig();
+	usage = owner.memory_usage();
+	AssertHelper::VerifyValue(1, (int)usage.dead_entries, "Slot hold cleaner until disconnect");
+
+	owner.disconnect();
+	usage = owner.memory_usage();
+	AssertHelper::VerifyValue(0, (int)usage.total(), "Slot empty");
+}
+
+void TestGlobalMemoryUsage()
+{
+	TestRunner::StartTest(MethodName);
+	lsignal::memory_usage_info before = lsignal::global_memory_usage();
+
+	{
+		lsignal::signal<void(int)> sig;
+		lsignal::slot owner;
+		for (int i = 0; i < 100; i++)
+			sig.connect([i](int) {}, &owner);
+
+		lsignal::memory_usage_info usage = sig.memory_usage();
+		usage += owner.memory_usage();
+
+		lsignal::memory_usage_info global = lsignal::global_memory_usage();
+		AssertHelper::VerifyValue((int)(before.total() + usage.total()), (int)global.total(), "Global include signal and slot");
+
+		lsignal::signal<void(int)> copy = sig;
+		global = lsignal::global_memory_usage();
+		AssertHelper::VerifyValue(true, global.callbacks > before.callbacks + usage.callbacks, "Copy allocate callbacks");
+	}
+
+	lsignal::memory_usage_info after = lsignal::global_memory_usage();
+	AssertHelper::VerifyValue((int)before.total(), (int)after.total(), "All released");
+}
+
 void CallBasicTests()
 {
 	ExecuteTest(CreateSignal_SignalShouldBeUnlocked);
@@ -698,7 +1641,10 @@ void CallBasicTests()
 	ExecuteTest(TestDestroySignal);
 
 	ExecuteTest(TestSignalSelfDelete);
+	ExecuteTest(TestSignalDeleteInNestedCall);
+	ExecuteTest(TestSignalDeleteDuringOtherThreadCall);
 	ExecuteTest(TestSignalCopy);
+	ExecuteTest(TestSignalCopyMoveOnlyCallback);
 	ExecuteTest(TestAddConnectionInCallback);
 	ExecuteTest(TestRemoveConnectionInCallback);
 	ExecuteTest(TestAddAndRemoveConnection);
@@ -711,11 +1657,34 @@ void CallBasicTests()
 
 	ExecuteTest(TestRecursiveSignalCall);
 	ExecuteTest(TestRecursiveSignalAddDelete);
+	ExecuteTest(TestAddManyConnectionsInCallback);
 
 	ExecuteTest(TestConnectEmptySignal);
+	ExecuteTest(TestConnectionCountChanges);
 
 	ExecuteTest(TestConnectionDisconnect);
 	ExecuteTest(TestConnectionDisconnectWithOwner);
 	ExecuteTest(TestConnectionDisconnectWithOwnerAfterOwnerDelete);
 	ExecuteTest(TestConnectionDisconnectWithOwnerAfterSignalDelete);
+
+	ExecuteTest(TestSlotCompactSignals);
+	ExecuteTest(TestSlotCompactSignalsInCallback);
+	ExecuteTest(TestSlotDisconnectFrom);
+	ExecuteTest(TestSlotCopy);
+	ExecuteTest(TestConnectionReplace);
+	ExecuteTest(TestRealtimeSignal);
+	ExecuteTest(TestActiveMask);
+	ExecuteTest(TestDisconnectInCallableDestructor);
+	ExecuteTest(TestForwardTo);
+	ExecuteTest(TestDisconnectAndWaitInCallback);
+	ExecuteTest(TestExceptionPropagate);
+	ExecuteTest(TestExceptionCatchAndContinue);
+	ExecuteTest(TestExceptionNoThrow);
+	ExecuteTest(TestLazySignalData);
+	ExecuteTest(TestFilteredConnection);
+	ExecuteTest(TestKeyedConnection);
+
+	ExecuteTest(TestSignalMemoryUsage);
+	ExecuteTest(TestSlotMemoryUsage);
+	ExecuteTest(TestGlobalMemoryUsage);
 }
\ No newline at end of file
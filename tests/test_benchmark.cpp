@@ -0,0 +1,978 @@
+#include "tests.h"
+#include "../lsignal_spsc.h"
+
+#include <chrono>
+#include <algorithm>
+
+#if defined(__unix__)
+#include "../lsignal_ipc.h"
+#include "../lsignal_journal.h"
+
+#include <sys/socket.h>
+#endif
+
+//Benchmarks are not run with tests, start: lsignal bench
+
+using bench_clock = std::chrono::steady_clock;
+
+void PrintResult(const char* name, bench_clock::duration elapsed, size_t ops)
+{
+	double ns = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+	std::cout << "  " << name << ": " << ns / ops << " ns/op (" << ops << " ops)\n";
+}
+
+#ifdef LSIGNAL_COROUTINES
+
+static CoTask AwaitLoop(lsignal::signal<void(int)>& sig, int& sum)
+{
+	while (auto value = co_await sig.next())
+		sum += std::get<0>(*value);
+}
+
+//Bridge coroutine with one-shot connection, as it was done before signal::next()
+struct OneShotAwaiter
+{
+	lsignal::signal<void(int)>& sig;
+	lsignal::connection conn;
+	int value = 0;
+
+	bool await_ready() const noexcept { return false; }
+	void await_suspend(std::coroutine_handle<> handle)
+	{
+		conn = sig.connect([this, handle](int v)
+		{
+			value = v;
+			conn.disconnect();
+			handle.resume();
+		}, nullptr);
+	}
+	int await_resume() { return value; }
+};
+
+static CoTask OneShotLoop(lsignal::signal<void(int)>& sig, int& sum, int count)
+{
+	for (int i = 0; i < count; i++)
+		sum += co_await OneShotAwaiter{ sig };
+}
+
+void BenchmarkCoroutineResume()
+{
+	TestRunner::StartTest(MethodName);
+	const int count = 1000000;
+
+	{
+		lsignal::signal<void(int)> sig;
+		int sum = 0;
+		CoTask task = AwaitLoop(sig, sum);
+
+		bench_clock::time_point start = bench_clock::now();
+		for (int i = 0; i < count; i++)
+			sig(1);
+		PrintResult("co_await signal::next()", bench_clock::now() - start, count);
+		AssertHelper::VerifyValue(count, sum, "All resumed");
+	}
+
+	{
+		lsignal::signal<void(int)> sig;
+		int sum = 0;
+		CoTask task = OneShotLoop(sig, sum, count);
+
+		bench_clock::time_point start = bench_clock::now();
+		for (int i = 0; i < count; i++)
+			sig(1);
+		PrintResult("co_await one-shot connection", bench_clock::now() - start, count);
+		AssertHelper::VerifyValue(count, sum, "All resumed");
+	}
+}
+
+#endif
+
+void BenchmarkSlotDestroy()
+{
+	TestRunner::StartTest(MethodName);
+
+	for (bool compact : { false, true })
+	{
+		for (size_t count : { 10, 1000, 100000 })
+		{
+			const size_t slots = std::max<size_t>(1, 1000000 / count);
+			lsignal::signal<void()> sig[4];
+			bench_clock::duration elapsed{};
+
+			for (size_t s = 0; s < slots; s++)
+			{
+				lsignal::slot* owner = new lsignal::slot();
+				owner->set_compact_signals(compact);
+				for (size_t i = 0; i < count; i++)
+					sig[i % 4].connect([]() {}, owner);
+
+				bench_clock::time_point start = bench_clock::now();
+				delete owner;
+				elapsed += bench_clock::now() - start;
+
+				for (lsignal::signal<void()>& sg : sig)
+					sg();
+			}
+
+			std::string name = "destroy slot with " + std::to_string(count) + " connections" + (compact ? ", compact signals" : "");
+			PrintResult(name.c_str(), elapsed, slots);
+		}
+	}
+}
+
+//Connect to 4 signals with one owner slot, slot index grows with every connection.
+void BenchmarkSlotConnect()
+{
+	TestRunner::StartTest(MethodName);
+
+	for (size_t count : { 10000, 100000 })
+	{
+		lsignal::signal<void()> sig[4];
+		lsignal::slot owner;
+
+		bench_clock::time_point start = bench_clock::now();
+		for (size_t i = 0; i < count; i++)
+			sig[i % 4].connect([]() {}, &owner);
+		bench_clock::duration elapsed = bench_clock::now() - start;
+
+		std::string name = "connect " + std::to_string(count) + " connections with one slot";
+		PrintResult(name.c_str(), elapsed, count);
+
+		start = bench_clock::now();
+		owner.disconnect_from(sig[0]);
+		PrintResult("disconnect_from one of 4 signals", bench_clock::now() - start, 1);
+	}
+}
+
+//Latency of single call while other threads connect, disconnect and compact.
+void BenchmarkCallLatencyUnderChurn()
+{
+	TestRunner::StartTest(MethodName);
+	const size_t count = 1000000;
+
+	for (bool realtime : { false, true })
+	{
+		lsignal::signal<void(int)> sig;
+		sig.set_realtime(realtime);
+
+		std::atomic<int> sum(0);
+		for (int i = 0; i < 16; i++)
+			sig.connect([&sum](int v) { sum.fetch_add(v, std::memory_order_relaxed); }, nullptr);
+
+		std::atomic_bool executing(true);
+		std::vector<std::thread> writers;
+		for (int t = 0; t < 2; t++)
+		{
+			writers.emplace_back([&executing, &sig, &sum, realtime]()
+			{
+				int idx = 0;
+				while (executing)
+				{
+					lsignal::slot owner;
+					for (int i = 0; i < 32; i++)
+						sig.connect([&sum](int v) { sum.fetch_add(v, std::memory_order_relaxed); }, &owner);
+
+					if (realtime && ++idx % 16 == 0)
+						sig.compact();
+				}
+			});
+		}
+
+		std::vector<bench_clock::duration> latency(count);
+		for (size_t i = 0; i < count; i++)
+		{
+			bench_clock::time_point start = bench_clock::now();
+			sig(1);
+			latency[i] = bench_clock::now() - start;
+		}
+
+		executing = false;
+		for (std::thread& t : writers)
+			t.join();
+
+		std::sort(latency.begin(), latency.end());
+		auto percentile = [&latency](double p)
+		{
+			size_t idx = std::min(latency.size() - 1, (size_t)(p * latency.size()));
+			return (long long)std::chrono::duration_cast<std::chrono::nanoseconds>(latency[idx]).count();
+		};
+
+		std::cout << "  " << (realtime ? "real-time" : "default") << " signal, 2 writer threads: p50=" << percentile(0.5)
+			<< " ns p99=" << percentile(0.99) << " ns p99.9=" << percentile(0.999)
+			<< " ns p99.99=" << percentile(0.9999) << " ns max=" << percentile(1.0) << " ns\n";
+	}
+}
+
+//Call after caches are evicted. Joints of signal copy point to connection records of original,
+//as all joints did before flags were allocated together with callback.
+void BenchmarkColdCall()
+{
+	TestRunner::StartTest(MethodName);
+	const size_t repeats = 500;
+	std::vector<char> evict(32 << 20);
+
+	for (size_t count : { 10, 100, 1000 })
+	{
+		lsignal::signal<void(int)> sig;
+		std::vector<int> values(count);
+		std::vector<std::unique_ptr<char[]>> scatter;
+		for (size_t i = 0; i < count; i++)
+		{
+			sig.connect([value = &values[i]](int v) { *value += v; }, nullptr);
+			scatter.emplace_back(new char[256]);
+		}
+
+		lsignal::signal<void(int)> copy = sig;
+
+		for (bool use_copy : { false, true })
+		{
+			const lsignal::signal<void(int)>& target = use_copy ? copy : sig;
+			bench_clock::duration elapsed{};
+
+			for (size_t r = 0; r < repeats; r++)
+			{
+				for (size_t i = 0; i < evict.size(); i += 64)
+					evict[i]++;
+
+				bench_clock::time_point start = bench_clock::now();
+				target(1);
+				elapsed += bench_clock::now() - start;
+			}
+
+			std::string name = std::to_string(count) + " connections, cold, " + (use_copy ? "flags out of line (copy)" : "flags inline");
+			PrintResult(name.c_str(), elapsed, repeats);
+		}
+	}
+}
+
+void BenchmarkSparseCall()
+{
+	TestRunner::StartTest(MethodName);
+	const int connections = 1000;
+	const int calls = 20000;
+
+	for (int percent : { 1, 10, 100 })
+	{
+		lsignal::signal<void(int)> sig;
+		std::vector<lsignal::connection> conns;
+		int sum = 0;
+
+		for (int i = 0; i < connections; i++)
+		{
+			//spread active connections over all mask words
+			conns.push_back(sig.connect([&sum](int v) { sum += v; }, nullptr));
+			conns.back().set_lock(i % (100 / percent) != 0);
+		}
+
+		//copy has all mask bits set, so it checks lock of every connection
+		lsignal::signal<void(int)> copy = sig;
+		const int active = connections * percent / 100;
+
+		for (lsignal::signal<void(int)>* target : { &sig, &copy })
+		{
+			sum = 0;
+			bench_clock::time_point start = bench_clock::now();
+			for (int i = 0; i < calls; i++)
+				(*target)(1);
+			bench_clock::duration elapsed = bench_clock::now() - start;
+
+			std::string name = std::to_string(percent) + "% active, " + (target == &sig ? "mask scan" : "all checked");
+			PrintResult(name.c_str(), elapsed, calls);
+			AssertHelper::VerifyValue(active * calls, sum, "Only active called");
+		}
+	}
+}
+
+void BenchmarkForwardChain()
+{
+	TestRunner::StartTest(MethodName);
+	const int calls = 200000;
+
+	for (size_t depth : { 1, 2, 4, 8, 16 })
+	{
+		for (bool fused : { false, true })
+		{
+			std::vector<lsignal::signal<void(int)>> chain(depth + 1);
+			int sum = 0;
+
+			for (size_t i = 0; i < depth; i++)
+			{
+				lsignal::signal<void(int)>& next = chain[i + 1];
+				if (fused)
+					chain[i].forward_to(next, nullptr);
+				else
+					chain[i].connect([&next](int v) { next(v); }, nullptr);
+			}
+			chain.back().connect([&sum](int v) { sum += v; }, nullptr);
+
+			bench_clock::time_point start = bench_clock::now();
+			for (int i = 0; i < calls; i++)
+				chain[0](1);
+			bench_clock::duration elapsed = bench_clock::now() - start;
+
+			std::string name = "depth " + std::to_string(depth) + ", " + (fused ? "forward_to" : "lambda calling signal");
+			PrintResult(name.c_str(), elapsed, calls);
+			AssertHelper::VerifyValue(calls, sum, "Called through chain");
+		}
+	}
+}
+
+void BenchmarkKeyedCall()
+{
+	TestRunner::StartTest(MethodName);
+	const int subscribers = 10000;
+	const int calls = 2000;
+
+	for (int mode = 0; mode < 3; mode++)
+	{
+		lsignal::signal<void(int, float)> sig;
+		float sum = 0;
+
+		for (int id = 0; id < subscribers; id++)
+		{
+			if (mode == 0)
+			{
+				sig.connect(std::function<void(int, float)>([&sum, id](int entity, float v)
+				{
+					if (entity != id)
+						return;
+					sum += v;
+				}), nullptr);
+			} else if (mode == 1)
+				sig.connect_filtered([id](int entity, float) { return entity == id; }, [&sum](int, float v) { sum += v; }, nullptr);
+			else
+				sig.connect_keyed(id, [&sum](int, float v) { sum += v; }, nullptr);
+		}
+
+		bench_clock::time_point start = bench_clock::now();
+		for (int i = 0; i < calls; i++)
+		{
+			if (mode == 2)
+				sig.emit_keyed(i * 7 % subscribers, i * 7 % subscribers, 1.0f);
+			else
+				sig(i * 7 % subscribers, 1.0f);
+		}
+		bench_clock::duration elapsed = bench_clock::now() - start;
+
+		const char* names[] = { "10000 subscribers, std::function with id check", "10000 subscribers, connect_filtered", "10000 subscribers, emit_keyed" };
+		PrintResult(names[mode], elapsed, calls);
+		AssertHelper::VerifyValue(calls, (int)sum, "One subscriber per call");
+	}
+}
+
+//Widget with many signals, most of them never connected
+struct BenchWidget
+{
+	lsignal::signal<void()> signals[20];
+
+	BenchWidget()
+	{
+	}
+
+	explicit BenchWidget(std::pmr::memory_resource* resource)
+	{
+		//internal data allocated at once, as before lazy allocation
+		for (lsignal::signal<void()>& sig : signals)
+			sig = lsignal::signal<void()>(resource);
+	}
+};
+
+void BenchmarkNeverConnectedSignals()
+{
+	TestRunner::StartTest(MethodName);
+	const size_t count = 1000000;
+
+	for (bool eager : { false, true })
+	{
+		std::vector<BenchWidget> widgets;
+		size_t storage = lsignal::global_memory_usage().storage;
+
+		bench_clock::time_point start = bench_clock::now();
+		widgets.reserve(count);
+		for (size_t i = 0; i < count; i++)
+		{
+			if (eager)
+				widgets.emplace_back(std::pmr::get_default_resource());
+			else
+				widgets.emplace_back();
+		}
+		bench_clock::duration elapsed = bench_clock::now() - start;
+
+		const char* mode = eager ? "allocated at construction" : "lazy";
+		std::string name = std::string("construct 1M objects x 20 signals, ") + mode;
+		PrintResult(name.c_str(), elapsed, count);
+
+		size_t bytes = sizeof(BenchWidget) + (lsignal::global_memory_usage().storage - storage) / count;
+		std::cout << "    " << bytes << " bytes per object\n";
+
+		start = bench_clock::now();
+		for (BenchWidget& widget : widgets)
+		{
+			for (const lsignal::signal<void()>& sig : widget.signals)
+				sig();
+		}
+		name = std::string("call never connected signal, ") + mode;
+		PrintResult(name.c_str(), bench_clock::now() - start, count * 20);
+
+		start = bench_clock::now();
+		widgets.clear();
+		name = std::string("destroy 1M objects x 20 signals, ") + mode;
+		PrintResult(name.c_str(), bench_clock::now() - start, count);
+	}
+}
+
+//Call of signal with 0, 1 and 2 connections, one callable called by inline single connection and
+//through array. Best of rounds, every case is measured in each round.
+void BenchmarkSubscriberCount()
+{
+	TestRunner::StartTest(MethodName);
+	const int calls = 4000000;
+	const int rounds = 5;
+
+	long long sum = 0;
+	const auto callback = [&sum](int v) { sum += v; };
+
+	lsignal::signal<void(int)> never_connected;
+	lsignal::signal<void(int)> allocated(std::pmr::get_default_resource());
+	lsignal::signal<void(int)> disconnected;
+	disconnected.connect(callback, nullptr).disconnect();
+	disconnected.compact();
+	lsignal::signal<void(int)> one;
+	one.connect(callback, nullptr);
+	lsignal::signal<void(int)> two;
+	two.connect(callback, nullptr);
+	two.connect(callback, nullptr);
+	//one callable called through array, as by general path
+	lsignal::signal<void(int)> one_of_two;
+	one_of_two.connect(callback, nullptr);
+	one_of_two.connect(callback, nullptr).set_lock(true);
+
+	const std::pair<const char*, lsignal::signal<void(int)>*> cases[] = {
+		{ "0 connections, never connected", &never_connected },
+		{ "0 connections, data allocated", &allocated },
+		{ "0 connections, all disconnected", &disconnected },
+		{ "1 connection", &one },
+		{ "1 of 2 connections unlocked (array)", &one_of_two },
+		{ "2 connections", &two },
+	};
+	const size_t case_count = sizeof(cases) / sizeof(cases[0]);
+
+	std::vector<bench_clock::duration> best(case_count, bench_clock::duration::max());
+	for (int round = 0; round < rounds; round++)
+	{
+		for (size_t c = 0; c < case_count; c++)
+		{
+			const lsignal::signal<void(int)>& sig = *cases[c].second;
+			bench_clock::time_point start = bench_clock::now();
+			for (int i = 0; i < calls; i++)
+				sig(1);
+			best[c] = std::min(best[c], bench_clock::now() - start);
+		}
+	}
+
+	for (size_t c = 0; c < case_count; c++)
+		PrintResult(cases[c].first, best[c], calls);
+
+	AssertHelper::VerifyValue(true, sum == 4LL * calls * rounds, "Called");
+}
+
+template<lsignal::exception_policy Policy>
+static void BenchmarkPolicyCall(const char* policy_name, int connections, int calls)
+{
+	lsignal::signal<void(int), Policy> sig;
+	int sum = 0;
+	for (int i = 0; i < connections; i++)
+		sig.connect([&sum](int v) noexcept { sum += v; }, nullptr);
+
+	bench_clock::time_point start = bench_clock::now();
+	for (int i = 0; i < calls; i++)
+		sig(1);
+	bench_clock::duration elapsed = bench_clock::now() - start;
+
+	std::string name = std::to_string(connections) + " connections, " + policy_name;
+	PrintResult(name.c_str(), elapsed, calls);
+	AssertHelper::VerifyValue(connections * calls, sum, "All called");
+}
+
+//Generated code of policies: make emit-codegen
+void BenchmarkExceptionPolicy()
+{
+	TestRunner::StartTest(MethodName);
+	const int calls = 10000000;
+
+	for (int connections : { 1, 10, 100 })
+	{
+		BenchmarkPolicyCall<lsignal::exception_policy::propagate>("propagate", connections, calls / connections);
+		BenchmarkPolicyCall<lsignal::exception_policy::catch_and_continue>("catch_and_continue", connections, calls / connections);
+		BenchmarkPolicyCall<lsignal::exception_policy::no_throw>("no_throw", connections, calls / connections);
+	}
+}
+
+static thread_local int bench_thread_calls = 0;
+
+//Threads emit one signal at the same time. Call of signal changes only its call counter,
+//copy of shared_ptr per call (signal data was held so before) is measured for comparison.
+void BenchmarkMultiThreadEmit()
+{
+	TestRunner::StartTest(MethodName);
+	const int calls = 2000000;
+	const int max_threads = (int)std::max(4u, std::thread::hardware_concurrency());
+
+	for (int thread_count = 1; thread_count <= max_threads; thread_count *= 2)
+	{
+		for (bool hold_copy : { false, true })
+		{
+			lsignal::signal<void(int)> sig;
+			sig.connect([](int v) { bench_thread_calls += v; }, nullptr);
+			std::shared_ptr<lsignal::signal<void(int)>> held(&sig, [](lsignal::signal<void(int)>*) {});
+
+			std::atomic<int> started(0);
+			std::atomic<int> total(0);
+			std::vector<std::thread> threads;
+			for (int t = 0; t < thread_count; t++)
+			{
+				threads.emplace_back([&, hold_copy]()
+				{
+					started++;
+					while (started < thread_count);
+
+					bench_thread_calls = 0;
+					for (int i = 0; i < calls; i++)
+					{
+						if (hold_copy)
+						{
+							std::shared_ptr<lsignal::signal<void(int)>> copy = held;
+							(*copy)(1);
+						}
+						else
+							sig(1);
+					}
+					total += bench_thread_calls;
+				});
+			}
+
+			while (started < thread_count);
+			bench_clock::time_point start = bench_clock::now();
+			for (std::thread& t : threads)
+				t.join();
+			bench_clock::duration elapsed = bench_clock::now() - start;
+
+			std::string name = std::to_string(thread_count) + " threads" + (hold_copy ? ", shared_ptr copy per call" : "");
+			PrintResult(name.c_str(), elapsed, (size_t)calls * thread_count);
+			AssertHelper::VerifyValue(calls * thread_count, total.load(), "All called");
+		}
+	}
+}
+
+//Game loop frame: 64 signals get 16 emits each, posted and called by run_pending(),
+//merged to one call per signal, or called immediately. Heap allocations are counted after first frame.
+//Strategy switch: one of 16 connections retargeted between emits, by replace or by
+//disconnect and connect. Owner slot holds cleaner of every reconnected connection.
+void BenchmarkReplaceCallback()
+{
+	TestRunner::StartTest(MethodName);
+	const int swaps = 200000;
+	const int connection_count = 16;
+
+	for (bool replace : { true, false })
+	{
+		lsignal::signal<void(int)> sig;
+		lsignal::slot owner;
+		long long sum = 0;
+		std::vector<lsignal::connection> connections;
+		for (int i = 0; i < connection_count; i++)
+			connections.push_back(sig.connect([&sum](int v) { sum += v; }, &owner));
+
+		size_t heap_before = HeapAllocationCount();
+		bench_clock::time_point start = bench_clock::now();
+		for (int i = 0; i < swaps; i++)
+		{
+			lsignal::connection& conn = connections[i % connection_count];
+			const auto strategy = [&sum, i](int v) { sum += v * (i & 1); };
+			if (replace)
+			{
+				sig.replace(conn, strategy);
+			} else
+			{
+				conn.disconnect();
+				conn = sig.connect(strategy, &owner);
+			}
+			sig(1);
+		}
+		bench_clock::duration elapsed = bench_clock::now() - start;
+
+		size_t allocations = HeapAllocationCount() - heap_before;
+		PrintResult(replace ? "replace" : "disconnect and connect", elapsed, swaps);
+		std::cout << "    " << (double)allocations / swaps << " heap allocations/swap, "
+			<< owner.memory_usage().dead_entries << " dead slot entries\n";
+	}
+}
+
+//Signal with 4 labeled connections, time of call with profiler disabled and sampling every Nth call.
+//Periods are measured in turn for several rounds, best round is taken.
+void BenchmarkProfilerOverhead()
+{
+	TestRunner::StartTest(MethodName);
+	const int calls = 1000000;
+	const int rounds = 5;
+	const uint32_t periods[] = { 0, 1, 4, 16, 64, 256, 1024 };
+	const size_t period_count = sizeof(periods) / sizeof(periods[0]);
+
+	lsignal::signal<void(int)> sig;
+	long long sum = 0;
+	for (int i = 0; i < 4; i++)
+		sig.connect_labeled("bench.handler", [&sum](int v) { sum += v; }, nullptr);
+
+	std::vector<double> best(period_count, 1e9);
+	for (int round = 0; round < rounds; round++)
+	{
+		for (size_t p = 0; p < period_count; p++)
+		{
+			lsignal::profiler::set_sampling_period(periods[p]);
+			sum = 0;
+
+			bench_clock::time_point start = bench_clock::now();
+			for (int i = 0; i < calls; i++)
+				sig(1);
+			bench_clock::duration elapsed = bench_clock::now() - start;
+
+			best[p] = std::min(best[p], (double)std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count() / calls);
+			AssertHelper::VerifyValue(true, sum == 4LL * calls, "Called");
+		}
+	}
+
+	for (size_t p = 0; p < period_count; p++)
+	{
+		std::cout << MakeString("  %-10s %7.2f ns/call, overhead %+6.1f%%\n",
+			periods[p] == 0 ? "disabled" : MakeString("1/%u", periods[p]).c_str(), best[p], (best[p] / best[0] - 1) * 100);
+	}
+
+	lsignal::profiler::set_sampling_period(0);
+	lsignal::profiler::reset();
+}
+
+void BenchmarkPostFrame()
+{
+	TestRunner::StartTest(MethodName);
+	const int frames = 20000;
+	const int signal_count = 64;
+	const int emits = 16;
+
+	std::vector<lsignal::signal<void(int, float)>> signals(signal_count);
+	long long sum = 0;
+	for (lsignal::signal<void(int, float)>& sig : signals)
+		sig.connect([&sum](int v, float) { sum += v; }, nullptr);
+
+	enum mode { immediate, post, post_merged };
+	const char* const names[] = { "immediate call", "post", "post_merged" };
+
+	for (mode m : { immediate, post, post_merged })
+	{
+		const auto frame = [&]()
+		{
+			for (int e = 0; e < emits; e++)
+			{
+				for (lsignal::signal<void(int, float)>& sig : signals)
+				{
+					if (m == immediate)
+						sig(1, 0.5f);
+					else if (m == post)
+						sig.post(1, 0.5f);
+					else
+						sig.post_merged(1, 0.5f);
+				}
+			}
+			lsignal::dispatcher::run_pending();
+		};
+
+		frame();
+		sum = 0;
+		size_t heap_before = HeapAllocationCount();
+
+		bench_clock::time_point start = bench_clock::now();
+		for (int f = 0; f < frames; f++)
+			frame();
+		bench_clock::duration elapsed = bench_clock::now() - start;
+
+		size_t allocations = HeapAllocationCount() - heap_before;
+		PrintResult(names[m], elapsed, (size_t)frames * signal_count * emits);
+		std::cout << "    " << std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count() / frames << " ns/frame, "
+			<< allocations << " heap allocations, arena " << lsignal::dispatcher::arena_capacity() << " bytes\n";
+		AssertHelper::VerifyValue(0, (int)allocations, "Frame without allocation");
+		AssertHelper::VerifyValue(true, sum == (long long)frames * signal_count * (m == post_merged ? 1 : emits), "Called");
+	}
+}
+
+//Producer thread emit into bridge, consumer thread started by bridge call signal.
+void BenchmarkSpscThroughput()
+{
+	TestRunner::StartTest(MethodName);
+	const int count = 4000000;
+
+	for (lsignal::spsc_wait wait : { lsignal::spsc_wait::spin, lsignal::spsc_wait::block })
+	{
+		for (size_t batch : { 1, 32 })
+		{
+			lsignal::signal<void(int, double)> sig;
+			long long sum = 0;
+			sig.connect([&sum](int v, double) { sum += v; }, nullptr);
+
+			lsignal::spsc_bridge<void(int, double)> bridge(sig, 4096, batch, wait);
+			bridge.start();
+
+			bench_clock::time_point start = bench_clock::now();
+			std::thread producer([&bridge, count]()
+			{
+				for (int i = 0; i < count; i++)
+					bridge(1, 0.5);
+				bridge.flush();
+			});
+			producer.join();
+			bridge.stop();
+			bench_clock::duration elapsed = bench_clock::now() - start;
+
+			std::string name = std::string(wait == lsignal::spsc_wait::spin ? "spin" : "block") + ", publish batch " + std::to_string(batch);
+			PrintResult(name.c_str(), elapsed, count);
+			std::cout << "    " << (long long)(count / std::chrono::duration<double>(elapsed).count()) << " events/s\n";
+			AssertHelper::VerifyValue(true, sum == count, "All received");
+		}
+	}
+}
+
+//Round trip: main thread emit into first bridge, its consumer thread emit into second bridge
+//which main thread drain. One way latency is half of round trip.
+void BenchmarkSpscLatency()
+{
+	TestRunner::StartTest(MethodName);
+	const int count = 100000;
+
+	for (lsignal::spsc_wait wait : { lsignal::spsc_wait::spin, lsignal::spsc_wait::block })
+	{
+		lsignal::signal<void(int)> ping;
+		lsignal::signal<void(int)> pong;
+		lsignal::spsc_bridge<void(int)> forward(ping, 64, 1, wait);
+		lsignal::spsc_bridge<void(int)> backward(pong, 64, 1, wait);
+
+		ping.connect([&backward](int v) { backward(v); }, nullptr);
+		int received = 0;
+		pong.connect([&received](int) { received++; }, nullptr);
+		forward.start();
+
+		bench_clock::time_point start = bench_clock::now();
+		for (int i = 0; i < count; i++)
+		{
+			forward(i);
+			while (backward.drain() == 0)
+				backward.wait(std::chrono::microseconds(0));
+		}
+		bench_clock::duration elapsed = bench_clock::now() - start;
+		forward.stop();
+
+		std::string name = std::string(wait == lsignal::spsc_wait::spin ? "spin" : "block") + " round trip";
+		PrintResult(name.c_str(), elapsed, count);
+		AssertHelper::VerifyValue(count, received, "All received");
+	}
+}
+
+#if defined(__unix__)
+
+struct IpcMessage
+{
+	int64_t seq;
+	double value;
+};
+
+//Both ends live in one process, but go through shared memory mapping or kernel socket
+//exactly as between processes.
+void BenchmarkIpcThroughput()
+{
+	TestRunner::StartTest(MethodName);
+	const int count = 1000000;
+	std::string name = "/lsignal_bench_" + std::to_string(getpid());
+
+	{
+		lsignal::ipc_signal<void(const IpcMessage&)> subscriber(name, 4096);
+		lsignal::ipc_signal<void(const IpcMessage&)> publisher(name);
+		std::atomic<int> received(0);
+		subscriber.connect([&received](const IpcMessage&) { received.fetch_add(1, std::memory_order_relaxed); }, nullptr);
+		subscriber.start();
+
+		bench_clock::time_point start = bench_clock::now();
+		for (int i = 0; i < count; i++)
+		{
+			while (!publisher(IpcMessage{ i, 1.0 }))
+				std::this_thread::yield();
+		}
+		while (received.load() < count)
+			std::this_thread::yield();
+		bench_clock::duration elapsed = bench_clock::now() - start;
+
+		subscriber.stop();
+		PrintResult("ipc_signal throughput", elapsed, count);
+		std::cout << "    " << (long long)(count / std::chrono::duration<double>(elapsed).count()) << " messages/s\n";
+	}
+	lsignal::ipc_channel::unlink(name);
+
+	int fds[2];
+	if (socketpair(AF_UNIX, SOCK_SEQPACKET, 0, fds) != 0)
+		return;
+
+	std::thread reader([fd = fds[1], count]()
+	{
+		IpcMessage msg;
+		for (int i = 0; i < count; i++)
+			recv(fd, &msg, sizeof(msg), 0);
+	});
+
+	bench_clock::time_point start = bench_clock::now();
+	for (int i = 0; i < count; i++)
+	{
+		IpcMessage msg{ i, 1.0 };
+		send(fds[0], &msg, sizeof(msg), 0);
+	}
+	reader.join();
+	bench_clock::duration elapsed = bench_clock::now() - start;
+
+	close(fds[0]);
+	close(fds[1]);
+	PrintResult("unix socket throughput", elapsed, count);
+	std::cout << "    " << (long long)(count / std::chrono::duration<double>(elapsed).count()) << " messages/s\n";
+}
+
+//Round trip: ping to echo thread and pong back.
+void BenchmarkIpcLatency()
+{
+	TestRunner::StartTest(MethodName);
+	const int count = 100000;
+	std::string ping_name = "/lsignal_bench_ping_" + std::to_string(getpid());
+	std::string pong_name = "/lsignal_bench_pong_" + std::to_string(getpid());
+
+	{
+		lsignal::ipc_signal<void(const IpcMessage&)> ping(ping_name, 64);
+		lsignal::ipc_signal<void(const IpcMessage&)> pong(pong_name, 64);
+		lsignal::ipc_signal<void(const IpcMessage&)> echo_in(ping_name);
+		lsignal::ipc_signal<void(const IpcMessage&)> echo_out(pong_name);
+
+		echo_in.connect([&echo_out](const IpcMessage& msg) { echo_out(msg); }, nullptr);
+		echo_in.start();
+
+		int received = 0;
+		pong.connect([&received](const IpcMessage&) { received++; }, nullptr);
+
+		bench_clock::time_point start = bench_clock::now();
+		for (int i = 0; i < count; i++)
+		{
+			ping(IpcMessage{ i, 1.0 });
+			while (pong.dispatch() == 0)
+				std::this_thread::yield();
+		}
+		bench_clock::duration elapsed = bench_clock::now() - start;
+
+		echo_in.stop();
+		PrintResult("ipc_signal round trip", elapsed, count);
+		AssertHelper::VerifyValue(count, received, "All echoed");
+	}
+	lsignal::ipc_channel::unlink(ping_name);
+	lsignal::ipc_channel::unlink(pong_name);
+
+	int fds[2];
+	if (socketpair(AF_UNIX, SOCK_SEQPACKET, 0, fds) != 0)
+		return;
+
+	std::thread echo([fd = fds[1], count]()
+	{
+		IpcMessage msg;
+		for (int i = 0; i < count; i++)
+		{
+			recv(fd, &msg, sizeof(msg), 0);
+			send(fd, &msg, sizeof(msg), 0);
+		}
+	});
+
+	bench_clock::time_point start = bench_clock::now();
+	for (int i = 0; i < count; i++)
+	{
+		IpcMessage msg{ i, 1.0 };
+		send(fds[0], &msg, sizeof(msg), 0);
+		recv(fds[0], &msg, sizeof(msg), 0);
+	}
+	bench_clock::duration elapsed = bench_clock::now() - start;
+	echo.join();
+
+	close(fds[0]);
+	close(fds[1]);
+	PrintResult("unix socket round trip", elapsed, count);
+}
+
+//Cost of recording emits of signal with one empty callback.
+void BenchmarkJournalRecording()
+{
+	TestRunner::StartTest(MethodName);
+	const size_t count = 2000000;
+	std::string path = "/tmp/lsignal_bench_journal_" + std::to_string(getpid()) + ".bin";
+
+	for (size_t threads : { 1, 4 })
+	{
+		for (bool record : { false, true })
+		{
+			lsignal::signal<void(int, double)> sig;
+			int sum = 0;
+			sig.connect([&sum](int v, double) { sum += v; }, nullptr);
+
+			lsignal::journal_recorder recorder(path, (size_t)256 << 20);
+			if (record)
+				recorder.attach(sig, 1);
+
+			bench_clock::time_point start = bench_clock::now();
+			std::vector<std::thread> workers;
+			for (size_t t = 0; t < threads; t++)
+			{
+				workers.emplace_back([&sig, count, threads]()
+				{
+					for (size_t i = 0; i < count / threads; i++)
+						sig((int)i, 1.0);
+				});
+			}
+			for (std::thread& t : workers)
+				t.join();
+			bench_clock::duration elapsed = bench_clock::now() - start;
+
+			std::string name = std::string(record ? "record" : "no record") + ", " + std::to_string(threads) + " threads";
+			PrintResult(name.c_str(), elapsed, count);
+			if (record)
+				std::cout << "    " << recorder.size() / (1024 * 1024) << " MiB, dropped " << recorder.dropped() << "\n";
+		}
+	}
+
+	unlink(path.c_str());
+}
+
+#endif
+
+void CallBenchmarkTests()
+{
+	ExecuteTest(BenchmarkSlotDestroy);
+	ExecuteTest(BenchmarkSlotConnect);
+	ExecuteTest(BenchmarkCallLatencyUnderChurn);
+	ExecuteTest(BenchmarkColdCall);
+	ExecuteTest(BenchmarkSparseCall);
+	ExecuteTest(BenchmarkForwardChain);
+	ExecuteTest(BenchmarkKeyedCall);
+	ExecuteTest(BenchmarkNeverConnectedSignals);
+	ExecuteTest(BenchmarkSubscriberCount);
+	ExecuteTest(BenchmarkExceptionPolicy);
+	ExecuteTest(BenchmarkMultiThreadEmit);
+	ExecuteTest(BenchmarkReplaceCallback);
+	ExecuteTest(BenchmarkProfilerOverhead);
+	ExecuteTest(BenchmarkPostFrame);
+	ExecuteTest(BenchmarkSpscThroughput);
+	ExecuteTest(BenchmarkSpscLatency);
+#if defined(__unix__)
+	ExecuteTest(BenchmarkIpcThroughput);
+	ExecuteTest(BenchmarkIpcLatency);
+	ExecuteTest(BenchmarkJournalRecording);
+#endif
+#ifdef LSIGNAL_COROUTINES
+	ExecuteTest(BenchmarkCoroutineResume);
+#endif
+}
@@ -0,0 +1,181 @@
+#include "tests.h"
+#include "../lsignal_coalescer.h"
+
+void TestCoalescerLatestValue()
+{
+	TestRunner::StartTest(MethodName);
+
+	lsignal::signal<void(int)> sig;
+	lsignal::coalescer<void(int)> co(sig);
+
+	int called = 0;
+	int value = 0;
+	sig.connect([&called, &value](int v) { called++; value = v; }, nullptr);
+
+	AssertHelper::VerifyValue(false, co.flush(), "Empty flush");
+
+	for (int i = 1; i <= 100; i++)
+		co(i);
+
+	AssertHelper::VerifyValue(100, (int)co.pending(), "Pending count");
+	AssertHelper::VerifyValue(0, called, "Not called before flush");
+
+	AssertHelper::VerifyValue(true, co.flush(), "Flush");
+	AssertHelper::VerifyValue(1, called, "Called once");
+	AssertHelper::VerifyValue(100, value, "Latest value");
+	AssertHelper::VerifyValue(0, (int)co.pending(), "Pending after flush");
+
+	AssertHelper::VerifyValue(false, co.flush(), "Second flush");
+	AssertHelper::VerifyValue(1, called, "Called once");
+}
+
+void TestCoalescerMerge()
+{
+	TestRunner::StartTest(MethodName);
+
+	lsignal::signal<void(int, const std::string&)> sig;
+	lsignal::coalescer<void(int, const std::string&)> co(sig,
+		[](std::tuple<int, std::string>& acc, std::tuple<int, std::string>&& next)
+	{
+		std::get<0>(acc) += std::get<0>(next);
+		std::get<1>(acc) += std::get<1>(next);
+	});
+
+	int called = 0;
+	int sum = 0;
+	std::string str;
+	sig.connect([&](int v, const std::string& s) { called++; sum = v; str = s; }, nullptr);
+
+	co(1, "a");
+	co(2, "b");
+	co(3, "c");
+	co.flush();
+
+	AssertHelper::VerifyValue(1, called, "Called once");
+	AssertHelper::VerifyValue(6, sum, "Merged sum");
+	AssertHelper::VerifyValue(true, str == "abc", "Merged in emit order");
+}
+
+void TestCoalescerFlushCount()
+{
+	TestRunner::StartTest(MethodName);
+
+	lsignal::signal<void(int)> sig;
+	lsignal::coalescer<void(int)> co(sig);
+	co.set_flush_count(10);
+
+	int called = 0;
+	int value = 0;
+	sig.connect([&called, &value](int v) { called++; value = v; }, nullptr);
+
+	for (int i = 1; i <= 25; i++)
+		co(i);
+
+	AssertHelper::VerifyValue(2, called, "Flushed by count");
+	AssertHelper::VerifyValue(20, value, "Value on last count flush");
+	AssertHelper::VerifyValue(5, (int)co.pending(), "Pending after count flush");
+}
+
+void TestCoalescerTick()
+{
+	TestRunner::StartTest(MethodName);
+
+	using clock = lsignal::coalescer<void(int)>::clock;
+
+	lsignal::signal<void(int)> sig;
+	lsignal::coalescer<void(int)> co(sig);
+	co.set_flush_interval(std::chrono::milliseconds(10));
+
+	int called = 0;
+	sig.connect([&called](int) { called++; }, nullptr);
+
+	clock::time_point t0 = clock::now();
+	co(1);
+	AssertHelper::VerifyValue(true, co.tick(t0), "First tick flush");
+
+	co(2);
+	AssertHelper::VerifyValue(false, co.tick(t0 + std::chrono::milliseconds(5)), "Tick before interval");
+	AssertHelper::VerifyValue(1, called, "Called once");
+
+	AssertHelper::VerifyValue(true, co.tick(t0 + std::chrono::milliseconds(10)), "Tick after interval");
+	AssertHelper::VerifyValue(2, called, "Called twice");
+}
+
+void TestCoalescerMultithread()
+{
+	TestRunner::StartTest(MethodName);
+
+	lsignal::signal<void(int)> sig;
+	lsignal::coalescer<void(int)> co(sig,
+		[](std::tuple<int>& acc, std::tuple<int>&& next) { std::get<0>(acc) += std::get<0>(next); });
+
+	std::atomic<int> sum(0);
+	sig.connect([&sum](int v) { sum += v; }, nullptr);
+
+	const int thread_count = 4;
+	const int emit_count = 20000;
+	std::atomic_bool producing(true);
+	std::vector<std::thread> threads;
+
+	for (int t = 0; t < thread_count; t++)
+	{
+		threads.emplace_back([&co]()
+		{
+			for (int i = 0; i < emit_count; i++)
+				co(1);
+		});
+	}
+
+	std::thread consumer([&co, &producing]()
+	{
+		while (producing)
+			co.flush();
+	});
+
+	for (std::thread& t : threads)
+		t.join();
+
+	producing = false;
+	consumer.join();
+	co.flush();
+
+	AssertHelper::VerifyValue(thread_count * emit_count, sum.load(), "All emits merged");
+}
+
+void TestCoalescerNoAllocation()
+{
+	TestRunner::StartTest(MethodName);
+
+	lsignal::signal<void(int)> sig;
+	int sum = 0;
+	int last = 0;
+	sig.connect([&sum, &last](int v) { sum += v; last = v; }, nullptr);
+
+	lsignal::coalescer<void(int)> latest(sig);
+	lsignal::coalescer<void(int)> merged(sig,
+		[](std::tuple<int>& acc, std::tuple<int>&& next) { std::get<0>(acc) += std::get<0>(next); }, 64);
+
+	//merged coalescer flushes itself when all 64 nodes are accumulated
+	const size_t allocations = HeapAllocationCount();
+	for (int i = 1; i <= 1000; i++)
+	{
+		latest(i);
+		merged(1);
+	}
+	latest.flush();
+	AssertHelper::VerifyValue(1000, last, "Latest value");
+	merged.flush();
+
+	AssertHelper::VerifyValue(0, (int)(HeapAllocationCount() - allocations), "Emit and flush don't allocate");
+	AssertHelper::VerifyValue(2000, sum, "All merged emits and latest value");
+}
+
+void CallCoalescerTests()
+{
+	ExecuteTest(TestCoalescerLatestValue);
+	ExecuteTest(TestCoalescerMerge);
+	ExecuteTest(TestCoalescerFlushCount);
+	ExecuteTest(TestCoalescerTick);
+	ExecuteTest(TestCoalescerMultithread);
+	ExecuteTest(TestCoalescerNoAllocation);
+}
@@ -0,0 +1,246 @@
+#include "tests.h"
+
+#ifdef LSIGNAL_COROUTINES
+
+static CoTask WaitValues(lsignal::signal<void(int, const std::string&)>& sig, int count, std::vector<std::string>& received)
+{
+	for (int i = 0; i < count; i++)
+	{
+		auto value = co_await sig.next();
+		if (!value)
+			co_return;
+
+		auto [number, str] = *value;
+		received.push_back(std::to_string(number) + str);
+	}
+}
+
+static CoTask WaitOnce(lsignal::signal<void(int)>& sig, int& result, bool& cancelled)
+{
+	auto value = co_await sig.next();
+	if (value)
+		result = std::get<0>(*value);
+	else
+		cancelled = true;
+}
+
+static CoTask WaitOwned(lsignal::signal<void(int)>& sig, lsignal::slot& owner, int& result, bool& cancelled)
+{
+	auto value = co_await sig.next(&owner);
+	if (value)
+		result = std::get<0>(*value);
+	else
+		cancelled = true;
+}
+
+void TestCoroutineNext()
+{
+	TestRunner::StartTest(MethodName);
+
+	lsignal::signal<void(int, const std::string&)> sig;
+	std::vector<std::string> received;
+
+	CoTask task = WaitValues(sig, 2, received);
+	AssertHelper::VerifyValue(false, task.done(), "Suspended before call");
+
+	sig(1, "a");
+	AssertHelper::VerifyValue(1, (int)received.size(), "Resumed once per call");
+	AssertHelper::VerifyValue(false, task.done(), "Waiting second value");
+
+	sig(2, "b");
+	AssertHelper::VerifyValue(2, (int)received.size(), "Resumed twice");
+	AssertHelper::VerifyValue(true, received[0] == "1a" && received[1] == "2b", "Arguments");
+	AssertHelper::VerifyValue(true, task.done(), "Completed");
+
+	sig(3, "c");
+	AssertHelper::VerifyValue(2, (int)received.size(), "Not resumed after completion");
+}
+
+void TestCoroutineSlotsCalledFirst()
+{
+	TestRunner::StartTest(MethodName);
+
+	lsignal::signal<void(int)> sig;
+	int slot_value = 0;
+	int result = 0;
+	bool cancelled = false;
+
+	CoTask task = WaitOnce(sig, result, cancelled);
+	sig.connect([&slot_value, &result](int v)
+	{
+		AssertHelper::VerifyValue(0, result, "Slot called before coroutine");
+		slot_value = v;
+	}, nullptr);
+
+	sig(5);
+	AssertHelper::VerifyValue(5, slot_value, "Slot called");
+	AssertHelper::VerifyValue(5, result, "Coroutine resumed");
+	AssertHelper::VerifyValue(true, task.done(), "Completed");
+}
+
+void TestCoroutineLockedSignal()
+{
+	TestRunner::StartTest(MethodName);
+
+	lsignal::signal<void(int)> sig;
+	int result = 0;
+	bool cancelled = false;
+
+	CoTask task = WaitOnce(sig, result, cancelled);
+
+	sig.set_lock(true);
+	sig(1);
+	AssertHelper::VerifyValue(false, task.done(), "Not resumed while locked");
+
+	sig.set_lock(false);
+	sig(2);
+	AssertHelper::VerifyValue(2, result, "Resumed after unlock");
+}
+
+void TestCoroutineDestroyFrame()
+{
+	TestRunner::StartTest(MethodName);
+
+	lsignal::signal<void(int)> sig;
+	int result = 0;
+	bool cancelled = false;
+
+	{
+		CoTask task = WaitOnce(sig, result, cancelled);
+	}
+
+	sig(1);
+	AssertHelper::VerifyValue(0, result, "Destroyed coroutine not resumed");
+
+	int result2 = 0;
+	CoTask task2 = WaitOnce(sig, result2, cancelled);
+	sig(2);
+	AssertHelper::VerifyValue(2, result2, "Other coroutine resumed");
+}
+
+void TestCoroutineDestroyOtherFrameInResume()
+{
+	TestRunner::StartTest(MethodName);
+
+	lsignal::signal<void(int)> sig;
+	lsignal::signal<void(int)> sig_killer;
+	int result0 = 0, result1 = 0;
+	bool cancelled = false;
+
+	std::unique_ptr<CoTask> victim;
+	auto killer = [&victim, &sig](int& result) -> CoTask
+	{
+		auto value = co_await sig.next();
+		result = std::get<0>(*value);
+		victim.reset();
+	};
+
+	CoTask task0 = killer(result0);
+	victim.reset(new CoTask(WaitOnce(sig, result1, cancelled)));
+
+	sig(7);
+	AssertHelper::VerifyValue(7, result0, "First resumed");
+	AssertHelper::VerifyValue(0, result1, "Destroyed in resume not resumed");
+}
+
+void TestCoroutineSignalDestroyed()
+{
+	TestRunner::StartTest(MethodName);
+
+	int result = 0;
+	bool cancelled = false;
+	lsignal::signal<void(int)>* sig = new lsignal::signal<void(int)>();
+
+	CoTask task = WaitOnce(*sig, result, cancelled);
+	delete sig;
+
+	AssertHelper::VerifyValue(true, cancelled, "Resumed with nullopt");
+	AssertHelper::VerifyValue(true, task.done(), "Completed");
+}
+
+static CoTask AwaitLater(lsignal::signal<void(int)>::awaiter& next, std::optional<std::tuple<int>>& value, bool& resumed)
+{
+	value = co_await next;
+	resumed = true;
+}
+
+void TestCoroutineSignalDestroyedBeforeAwait()
+{
+	TestRunner::StartTest(MethodName);
+
+	std::optional<std::tuple<int>> value(std::make_tuple(1));
+	bool resumed = false;
+	lsignal::signal<void(int)>* sig = new lsignal::signal<void(int)>();
+
+	//awaiter is taken, signal is destroyed before co_await
+	lsignal::signal<void(int)>::awaiter next = sig->next();
+	delete sig;
+
+	CoTask task = AwaitLater(next, value, resumed);
+
+	AssertHelper::VerifyValue(true, resumed, "Resumed without suspension");
+	AssertHelper::VerifyValue(false, value.has_value(), "Resumed with nullopt");
+	AssertHelper::VerifyValue(true, task.done(), "Completed");
+}
+
+void TestCoroutineOwnerDisconnected()
+{
+	TestRunner::StartTest(MethodName);
+
+	lsignal::signal<void(int)> sig;
+	int result = 0;
+	bool cancelled = false;
+
+	{
+		lsignal::slot owner;
+		CoTask task = WaitOwned(sig, owner, result, cancelled);
+		AssertHelper::VerifyValue(0, (int)owner.connection_count(), "Awaiter is not a connection");
+
+		owner.disconnect();
+		AssertHelper::VerifyValue(true, cancelled, "Resumed with nullopt");
+		AssertHelper::VerifyValue(true, task.done(), "Completed");
+
+		sig(5);
+		AssertHelper::VerifyValue(0, result, "Not resumed by call");
+	}
+
+	cancelled = false;
+	{
+		lsignal::slot owner;
+		CoTask task = WaitOwned(sig, owner, result, cancelled);
+		sig(6);
+		AssertHelper::VerifyValue(6, result, "Resumed by call");
+	}
+	AssertHelper::VerifyValue(false, cancelled, "Not resumed again by owner destruction");
+
+	{
+		lsignal::slot owner;
+		lsignal::signal<void(int)>::awaiter next = sig.next(&owner);
+		owner.disconnect_from(sig);
+
+		std::optional<std::tuple<int>> value(std::make_tuple(1));
+		bool resumed = false;
+		CoTask task = AwaitLater(next, value, resumed);
+		AssertHelper::VerifyValue(true, resumed && !value.has_value(), "Owner disconnected before co_await");
+	}
+}
+
+void CallCoroutineTests()
+{
+	ExecuteTest(TestCoroutineNext);
+	ExecuteTest(TestCoroutineSlotsCalledFirst);
+	ExecuteTest(TestCoroutineLockedSignal);
+	ExecuteTest(TestCoroutineDestroyFrame);
+	ExecuteTest(TestCoroutineDestroyOtherFrameInResume);
+	ExecuteTest(TestCoroutineSignalDestroyed);
+	ExecuteTest(TestCoroutineSignalDestroyedBeforeAwait);
+	ExecuteTest(TestCoroutineOwnerDisconnected);
+}
+
+#else
+
+void CallCoroutineTests()
+{
+}
+
+#endif
@@ -0,0 +1,204 @@
+#include "tests.h"
+
+#include <string>
+#include <vector>
+
+void TestPostRunPending()
+{
+	TestRunner::StartTest(MethodName);
+
+	lsignal::signal<void(int, const std::string&)> sig;
+	std::vector<int> order;
+	std::string text;
+	sig.connect([&order, &text](int v, const std::string& s) { order.push_back(v); text += s; }, nullptr);
+
+	std::string arg = "a";
+	sig.post(1, arg);
+	arg = "b";
+	sig.post(2, arg);
+	sig.post(3, "c");
+
+	AssertHelper::VerifyValue(3, (int)lsignal::dispatcher::pending(), "Pending");
+	AssertHelper::VerifyValue(true, order.empty(), "Not called before run_pending");
+
+	AssertHelper::VerifyValue(3, (int)lsignal::dispatcher::run_pending(), "Run");
+	AssertHelper::VerifyValue(true, order == std::vector<int>({ 1, 2, 3 }), "Post order");
+	AssertHelper::VerifyValue(true, text == "abc", "Arguments copied at post");
+	AssertHelper::VerifyValue(0, (int)lsignal::dispatcher::run_pending(), "Nothing pending");
+}
+
+void TestPostInCallback()
+{
+	TestRunner::StartTest(MethodName);
+
+	lsignal::signal<void(int)> a;
+	lsignal::signal<void(int)> b;
+	int nesting = 0;
+	int max_nesting = 0;
+	std::vector<int> order;
+
+	//every call post two more up to depth 4, all are called by one run without recursion
+	const auto receive = [&](int depth)
+	{
+		nesting++;
+		max_nesting = std::max(max_nesting, nesting);
+		order.push_back(depth);
+		if (depth < 4)
+		{
+			a.post(depth + 1);
+			b.post(depth + 1);
+		}
+		nesting--;
+	};
+	a.connect(receive, nullptr);
+	b.connect(receive, nullptr);
+
+	a.post(0);
+	AssertHelper::VerifyValue(31, (int)lsignal::dispatcher::run_pending(), "Posts of posts run");
+	AssertHelper::VerifyValue(1, max_nesting, "No recursion");
+	AssertHelper::VerifyValue(true, std::is_sorted(order.begin(), order.end()), "Breadth first order");
+}
+
+void TestPostMerged()
+{
+	TestRunner::StartTest(MethodName);
+
+	lsignal::signal<void(int)> a;
+	lsignal::signal<void(int)> b;
+	std::vector<int> order;
+	a.connect([&order](int v) { order.push_back(v); }, nullptr);
+	b.connect([&order, &a](int v)
+	{
+		order.push_back(v);
+		//pending merged post of a was called, so new post is added
+		if (v == 20)
+			a.post_merged(3);
+	}, nullptr);
+
+	a.post_merged(1);
+	b.post_merged(10);
+	a.post_merged(2);
+	b.post(20);
+	AssertHelper::VerifyValue(3, (int)lsignal::dispatcher::pending(), "Merged post");
+
+	lsignal::dispatcher::run_pending();
+	AssertHelper::VerifyValue(true, order == std::vector<int>({ 2, 10, 20, 3 }), "Latest arguments, first place");
+
+	//many signals, merge table grows
+	std::vector<lsignal::signal<void(int)>> signals(100);
+	int sum = 0;
+	for (lsignal::signal<void(int)>& sig : signals)
+		sig.connect([&sum](int v) { sum += v; }, nullptr);
+
+	for (int round = 1; round <= 3; round++)
+	{
+		for (lsignal::signal<void(int)>& sig : signals)
+			sig.post_merged(round);
+	}
+
+	AssertHelper::VerifyValue(100, (int)lsignal::dispatcher::run_pending(), "One post per signal");
+	AssertHelper::VerifyValue(300, sum, "Latest arguments");
+}
+
+void TestPostSignalDestroyed()
+{
+	TestRunner::StartTest(MethodName);
+
+	int called = 0;
+	{
+		lsignal::signal<void()> sig;
+		sig.connect([&called]() { called++; }, nullptr);
+		sig.post();
+		sig.post_merged();
+	}
+
+	lsignal::signal<void()>* deleted = new lsignal::signal<void()>();
+	lsignal::signal<void()> deleter;
+	deleter.connect([&deleted]() { delete deleted; deleted = nullptr; }, nullptr);
+	deleted->connect([&called]() { called++; }, nullptr);
+	deleter.post();
+	deleted->post();
+
+	lsignal::dispatcher::run_pending();
+	AssertHelper::VerifyValue(0, called, "Destroyed signal not called");
+	AssertHelper::VerifyValue(true, deleted == nullptr, "Deleted by post");
+
+	lsignal::signal<void()> sig;
+	sig.connect([&called]() { called++; }, nullptr);
+	sig.post();
+	lsignal::dispatcher::clear();
+	AssertHelper::VerifyValue(0, (int)lsignal::dispatcher::run_pending(), "Cleared");
+	AssertHelper::VerifyValue(0, called, "Cleared post not called");
+}
+
+void TestPostThreadQueue()
+{
+	TestRunner::StartTest(MethodName);
+
+	lsignal::signal<void(int)> sig;
+	std::atomic<int> sum(0);
+	sig.connect([&sum](int v) { sum += v; }, nullptr);
+
+	std::thread other([&sig]()
+	{
+		sig.post(1);
+		sig.post(2);
+	});
+	other.join();
+
+	sig.post(10);
+	AssertHelper::VerifyValue(1, (int)lsignal::dispatcher::run_pending(), "Only posts of this thread");
+	AssertHelper::VerifyValue(10, sum.load(), "Posts of finished thread dropped");
+
+	std::thread runner([&sig]()
+	{
+		sig.post(100);
+		lsignal::dispatcher::run_pending();
+	});
+	runner.join();
+	AssertHelper::VerifyValue(110, sum.load(), "Run by posting thread");
+}
+
+void TestPostWithoutAllocation()
+{
+	TestRunner::StartTest(MethodName);
+
+	lsignal::signal<void(int, const std::string&)> sig;
+	lsignal::signal<void(int)> merged;
+	int sum = 0;
+	sig.connect([&sum](int v, const std::string&) { sum += v; }, nullptr);
+	merged.connect([&sum](int v) { sum += v; }, nullptr);
+
+	const std::string small = "short";
+	const auto frame = [&]()
+	{
+		for (int i = 0; i < 1000; i++)
+		{
+			sig.post(1, small);
+			merged.post_merged(i);
+		}
+		lsignal::dispatcher::run_pending();
+	};
+
+	//first frame grows arena
+	frame();
+	size_t capacity = lsignal::dispatcher::arena_capacity();
+
+	size_t heap_before = HeapAllocationCount();
+	for (int i = 0; i < 10; i++)
+		frame();
+
+	AssertHelper::VerifyValue(0, (int)(HeapAllocationCount() - heap_before), "Frame touch global heap");
+	AssertHelper::VerifyValue(true, capacity == lsignal::dispatcher::arena_capacity(), "Arena reused");
+	AssertHelper::VerifyValue(11 * (1000 + 999), sum, "Called");
+}
+
+void CallDispatcherTests()
+{
+	ExecuteTest(TestPostRunPending);
+	ExecuteTest(TestPostInCallback);
+	ExecuteTest(TestPostMerged);
+	ExecuteTest(TestPostSignalDestroyed);
+	ExecuteTest(TestPostThreadQueue);
+	ExecuteTest(TestPostWithoutAllocation);
+}
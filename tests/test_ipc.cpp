@@ -0,0 +1,142 @@
+#include "tests.h"
+
+#if defined(__unix__)
+
+#include "../lsignal_ipc.h"
+
+#include <sys/wait.h>
+
+struct IpcPoint
+{
+	int x;
+	int y;
+};
+
+static std::string IpcName(const char* test)
+{
+	return "/lsignal_test_" + std::to_string(getpid()) + "_" + test;
+}
+
+void TestIpcSameProcess()
+{
+	TestRunner::StartTest(MethodName);
+	std::string name = IpcName("same");
+
+	{
+		lsignal::ipc_signal<void(int, const IpcPoint&)> publisher(name);
+		lsignal::ipc_signal<void(int, const IpcPoint&)> subscriber(name);
+		AssertHelper::VerifyValue(true, publisher.is_open() && subscriber.is_open(), "Opened");
+
+		AssertHelper::VerifyValue(true, publisher(0, IpcPoint{ 0, 0 }), "Write without subscribers");
+
+		int sum = 0;
+		lsignal::slot owner;
+		subscriber.connect([&sum](int v, const IpcPoint& pt) { sum += v * (pt.x + pt.y); }, &owner);
+
+		for (int i = 1; i <= 3; i++)
+			publisher(i, IpcPoint{ i, 1 });
+
+		AssertHelper::VerifyValue(3, (int)subscriber.dispatch(), "Dispatched");
+		AssertHelper::VerifyValue(1 * 2 + 2 * 3 + 3 * 4, sum, "Arguments");
+		AssertHelper::VerifyValue(0, (int)subscriber.dispatch(), "Nothing pending");
+		AssertHelper::VerifyValue(0, (int)publisher.dispatch(), "Publisher not subscribed");
+	}
+
+	lsignal::ipc_channel::unlink(name);
+}
+
+void TestIpcRingFull()
+{
+	TestRunner::StartTest(MethodName);
+	std::string name = IpcName("full");
+
+	{
+		lsignal::ipc_signal<void(int)> publisher(name, 4);
+		lsignal::ipc_signal<void(int)> subscriber(name);
+
+		int called = 0;
+		subscriber.connect([&called](int) { called++; }, nullptr);
+
+		for (int i = 0; i < 4; i++)
+			AssertHelper::VerifyValue(true, publisher(i), "Write");
+
+		AssertHelper::VerifyValue(false, publisher(4), "Ring full");
+		AssertHelper::VerifyValue(4, (int)subscriber.dispatch(), "Dispatched");
+		AssertHelper::VerifyValue(true, publisher(5), "Write after read");
+		AssertHelper::VerifyValue(1, (int)subscriber.dispatch(), "Dispatched");
+		AssertHelper::VerifyValue(5, called, "Called");
+	}
+
+	lsignal::ipc_channel::unlink(name);
+}
+
+void TestIpcMessageSizeMismatch()
+{
+	TestRunner::StartTest(MethodName);
+	std::string name = IpcName("mismatch");
+
+	{
+		lsignal::ipc_signal<void(int)> sig(name);
+		lsignal::ipc_signal<void(int, double)> other(name);
+		AssertHelper::VerifyValue(true, sig.is_open(), "Opened");
+		AssertHelper::VerifyValue(false, other.is_open(), "Different arguments not opened");
+		AssertHelper::VerifyValue(false, other(1, 2.0), "Write to closed");
+	}
+
+	lsignal::ipc_channel::unlink(name);
+}
+
+void TestIpcOtherProcess()
+{
+	TestRunner::StartTest(MethodName);
+	std::string name = IpcName("process");
+	const int count = 10000;
+
+	lsignal::ipc_signal<void(int)> subscriber(name, 256);
+	std::atomic<int> received(0);
+	std::atomic<int> sum(0);
+	subscriber.connect([&received, &sum](int v) { sum += v; received++; }, nullptr);
+
+	//child must not print buffered output again
+	std::cout.flush();
+	pid_t pid = fork();
+	if (pid == 0)
+	{
+		lsignal::ipc_channel channel(name, sizeof(int), 0);
+		for (int i = 1; i <= count; i++)
+		{
+			while (!channel.write(&i))
+				std::this_thread::yield();
+		}
+		_exit(0);
+	}
+
+	subscriber.start();
+	for (int i = 0; i < 5000 && received < count; i++)
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	subscriber.stop();
+
+	int status = 0;
+	waitpid(pid, &status, 0);
+	lsignal::ipc_channel::unlink(name);
+
+	AssertHelper::VerifyValue(true, WIFEXITED(status), "Child exited");
+	AssertHelper::VerifyValue(count, received.load(), "All received");
+	AssertHelper::VerifyValue(count * (count + 1) / 2, sum.load(), "Not lost, not duplicated");
+}
+
+void CallIpcTests()
+{
+	ExecuteTest(TestIpcSameProcess);
+	ExecuteTest(TestIpcRingFull);
+	ExecuteTest(TestIpcMessageSizeMismatch);
+	ExecuteTest(TestIpcOtherProcess);
+}
+
+#else
+
+void CallIpcTests()
+{
+}
+
+#endif
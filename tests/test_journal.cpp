@@ -0,0 +1,183 @@
+#include "tests.h"
+
+#if defined(__unix__)
+
+#include "../lsignal_journal.h"
+
+struct JournalPoint
+{
+	float x;
+	float y;
+};
+
+static std::string JournalPath(const char* test)
+{
+	return "/tmp/lsignal_journal_" + std::to_string(getpid()) + "_" + test + ".bin";
+}
+
+void TestJournalRecordReplay()
+{
+	TestRunner::StartTest(MethodName);
+	std::string path = JournalPath("replay");
+
+	lsignal::signal<void(int, const JournalPoint&)> moved;
+	lsignal::signal<void()> clicked;
+
+	{
+		lsignal::journal_recorder recorder(path, 1 << 20, 4096);
+		AssertHelper::VerifyValue(true, recorder.is_open(), "Opened");
+
+		recorder.attach(moved, 1);
+		recorder.attach(clicked, 2);
+
+		moved(1, JournalPoint{ 1.0f, 2.0f });
+		clicked();
+		moved(2, JournalPoint{ 3.0f, 4.0f });
+
+		std::thread t([&moved]()
+		{
+			for (int i = 0; i < 1000; i++)
+				moved(100 + i, JournalPoint{ 0.0f, 0.0f });
+		});
+		t.join();
+
+		AssertHelper::VerifyValue(0, (int)recorder.dropped(), "Nothing dropped");
+	}
+
+	moved(-1, JournalPoint{});
+	AssertHelper::VerifyValue(true, moved.empty(), "Recorder disconnected");
+
+	lsignal::journal_replayer replayer(path);
+	AssertHelper::VerifyValue(true, replayer.is_open(), "Replayer opened");
+	AssertHelper::VerifyValue(1003, (int)replayer.size(), "Records");
+
+	lsignal::signal<void(int, const JournalPoint&)> moved_copy;
+	lsignal::signal<void()> clicked_copy;
+	std::vector<int> ids;
+	float sum = 0;
+	int clicks = 0;
+	moved_copy.connect([&ids, &sum](int id, const JournalPoint& pt) { ids.push_back(id); sum += pt.x + pt.y; }, nullptr);
+	clicked_copy.connect([&clicks, &ids]() { clicks++; ids.push_back(0); }, nullptr);
+
+	replayer.bind(1, moved_copy);
+	AssertHelper::VerifyValue(1002, (int)replayer.replay(), "Only bound signal replayed");
+
+	replayer.bind(2, clicked_copy);
+	ids.clear();
+	sum = 0;
+	AssertHelper::VerifyValue(1003, (int)replayer.replay(), "Replayed");
+	AssertHelper::VerifyValue(1, clicks, "Clicked");
+	AssertHelper::VerifyValue(true, ids[0] == 1 && ids[1] == 0 && ids[2] == 2 && ids[3] == 100 && ids.back() == 1099, "Emit order");
+	AssertHelper::VerifyValue(true, sum == 10.0f, "Arguments");
+
+	unlink(path.c_str());
+}
+
+void TestJournalOriginalTiming()
+{
+	TestRunner::StartTest(MethodName);
+	std::string path = JournalPath("timing");
+
+	lsignal::signal<void(int)> sig;
+	{
+		lsignal::journal_recorder recorder(path, 1 << 16);
+		recorder.attach(sig, 7);
+		sig(1);
+		std::this_thread::sleep_for(std::chrono::milliseconds(30));
+		sig(2);
+	}
+
+	lsignal::journal_replayer replayer(path);
+	lsignal::signal<void(int)> target;
+	int sum = 0;
+	target.connect([&sum](int v) { sum += v; }, nullptr);
+	replayer.bind(7, target);
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	replayer.replay(lsignal::journal_replayer::timing::original);
+	std::chrono::steady_clock::duration elapsed = std::chrono::steady_clock::now() - start;
+
+	AssertHelper::VerifyValue(3, sum, "Replayed");
+	AssertHelper::VerifyValue(true, elapsed >= std::chrono::milliseconds(30), "Original timing");
+
+	start = std::chrono::steady_clock::now();
+	replayer.replay();
+	AssertHelper::VerifyValue(true, std::chrono::steady_clock::now() - start < std::chrono::milliseconds(30), "Full speed");
+
+	unlink(path.c_str());
+}
+
+void TestJournalFull()
+{
+	TestRunner::StartTest(MethodName);
+	std::string path = JournalPath("full");
+
+	lsignal::signal<void(int)> sig;
+	size_t dropped = 0;
+	{
+		//header chunk and one chunk for records
+		lsignal::journal_recorder recorder(path, 2 * 256, 256);
+		recorder.attach(sig, 1);
+		for (int i = 0; i < 100; i++)
+			sig(i);
+		dropped = recorder.dropped();
+	}
+
+	lsignal::journal_replayer replayer(path);
+	AssertHelper::VerifyValue(true, dropped > 0, "Dropped when full");
+	AssertHelper::VerifyValue(100, (int)(replayer.size() + dropped), "Recorded or dropped");
+
+	unlink(path.c_str());
+}
+
+void TestJournalTwoRecorders()
+{
+	TestRunner::StartTest(MethodName);
+	std::string first_path = JournalPath("first");
+	std::string second_path = JournalPath("second");
+
+	lsignal::signal<void(int)> sig;
+	size_t first_size = 0;
+	size_t second_size = 0;
+	{
+		lsignal::journal_recorder first(first_path, 1 << 20, 4096);
+		lsignal::journal_recorder second(second_path, 1 << 20, 4096);
+		first.attach(sig, 1);
+		second.attach(sig, 2);
+
+		//records of 32 bytes, each recorder writes them into its own chunk
+		for (int i = 0; i < 200; i++)
+			sig(i);
+
+		first_size = first.size();
+		second_size = second.size();
+	}
+
+	//header chunk and two chunks for 200 records
+	AssertHelper::VerifyValue(3 * 4096, (int)first_size, "First recorder keeps its chunk");
+	AssertHelper::VerifyValue(3 * 4096, (int)second_size, "Second recorder keeps its chunk");
+
+	lsignal::journal_replayer first_replayer(first_path);
+	lsignal::journal_replayer second_replayer(second_path);
+	AssertHelper::VerifyValue(200, (int)first_replayer.size(), "First records");
+	AssertHelper::VerifyValue(200, (int)second_replayer.size(), "Second records");
+
+	unlink(first_path.c_str());
+	unlink(second_path.c_str());
+}
+
+void CallJournalTests()
+{
+	ExecuteTest(TestJournalRecordReplay);
+	ExecuteTest(TestJournalOriginalTiming);
+	ExecuteTest(TestJournalFull);
+	ExecuteTest(TestJournalTwoRecorders);
+}
+
+#else
+
+void CallJournalTests()
+{
+}
+
+#endif
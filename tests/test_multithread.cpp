@@ -45,8 +45,8 @@ void TestThreadAddDeleteCall()
 
 	lsignal::signal<void()> sig;
 
-	int call0_count = 0;
-	int call1_count = 0;
+	std::atomic<int> call0_count(0);
+	std::atomic<int> call1_count(0);
 
 	std::thread t1([&thread_wait_starting, &thread_started, &thread_executing, &sig, &call1_count]()
 	{
@@ -98,8 +98,8 @@ void TestThreadDisconnectConnection()
 
 	lsignal::signal<void()> sig;
 
-	int call0_count = 0;
-	int call1_count = 0;
+	std::atomic<int> call0_count(0);
+	std::atomic<int> call1_count(0);
 
 	std::thread t1([&thread_wait_starting, &thread_started, &thread_executing, &sig, &call1_count]()
 	{
@@ -147,8 +147,297 @@ void TestThreadDisconnectConnection()
 	std::cout << "elapsed time = " << std::chrono::duration_cast<std::chrono::milliseconds>(t_end - t_start).count() << " ms\n";
 }
 
+void TestThreadRealtimeCall()
+{
+	TestRunner::StartTest(MethodName);
+	std::atomic_bool thread_executing(true);
+
+	lsignal::signal<void(int)> sig;
+	sig.set_realtime(true);
+
+	std::atomic<int> call0_count(0);
+	std::atomic<int> call1_count(0);
+
+	for (int i = 0; i < 5; i++)
+		sig.connect([&call0_count](int v) { call0_count += v; }, nullptr);
+
+	std::vector<std::thread> writers;
+	for (int t = 0; t < 2; t++)
+	{
+		writers.emplace_back([&thread_executing, &sig, &call1_count]()
+		{
+			int idx = 0;
+			while (thread_executing)
+			{
+				lsignal::slot owner;
+				for (int i = 0; i < 10; i++)
+					sig.connect([&call1_count](int v) { call1_count += v; }, &owner);
+
+				if (++idx % 16 == 0)
+					sig.compact();
+			}
+		});
+	}
+
+	const int count = 100000;
+	for (int i = 0; i < count; i++)
+		sig(1);
+
+	thread_executing = false;
+	for (std::thread& t : writers)
+		t.join();
+
+	AssertHelper::VerifyValue(5 * count, call0_count.load(), "Persistent connections called every time");
+
+	sig.compact();
+	lsignal::memory_usage_info usage = sig.memory_usage();
+	AssertHelper::VerifyValue(5, (int)(usage.connections / lsignal::connection_data::allocated_size), "Compacted");
+
+	std::cout << "call1_count=" << call1_count << "\n";
+}
+
+void TestThreadKeyedCall()
+{
+	TestRunner::StartTest(MethodName);
+	std::atomic_bool thread_executing(true);
+
+	lsignal::signal<void(int)> sig;
+	std::atomic<int> call0_count(0);
+	std::atomic<int> call1_count(0);
+
+	for (int key = 0; key < 4; key++)
+		sig.connect_keyed(key, [&call0_count](int v) { call0_count += v; }, nullptr);
+
+	//new keys grow index while it is read
+	std::thread writer([&thread_executing, &sig, &call1_count]()
+	{
+		int key = 100;
+		while (thread_executing)
+		{
+			lsignal::slot owner;
+			for (int i = 0; i < 10; i++)
+				sig.connect_keyed(key++ % 1000, [&call1_count](int v) { call1_count += v; }, &owner);
+		}
+	});
+
+	const int count = 100000;
+	for (int i = 0; i < count; i++)
+	{
+		sig.emit_keyed(i % 4, 1);
+		sig.emit_keyed(100 + i % 900, 1);
+	}
+
+	thread_executing = false;
+	writer.join();
+
+	AssertHelper::VerifyValue(count, call0_count.load(), "Persistent keyed connections called every time");
+
+	sig.compact();
+	lsignal::memory_usage_info usage = sig.memory_usage();
+	AssertHelper::VerifyValue(4, (int)(usage.connections / lsignal::connection_data::allocated_size), "Compacted");
+}
+
+void TestThreadLazyConnect()
+{
+	TestRunner::StartTest(MethodName);
+
+	for (int repeat = 0; repeat < 1000; repeat++)
+	{
+		lsignal::signal<void(int)> sig;
+		std::atomic<int> called(0);
+		std::atomic<bool> start(false);
+
+		//first connects race to allocate internal data
+		std::vector<std::thread> writers;
+		for (int t = 0; t < 2; t++)
+		{
+			writers.emplace_back([&sig, &called, &start]()
+			{
+				while (!start)
+					std::this_thread::yield();
+				sig.connect([&called](int v) { called += v; }, nullptr);
+			});
+		}
+
+		start = true;
+		for (int i = 0; i < 10; i++)
+			sig(0);
+
+		for (std::thread& t : writers)
+			t.join();
+
+		sig(1);
+		AssertHelper::VerifyValue(2, called.load(), "Both connections kept");
+	}
+}
+
+void TestThreadDisconnectAndWait()
+{
+	TestRunner::StartTest(MethodName);
+	std::atomic_bool thread_executing(true);
+
+	lsignal::signal<void(int)> sig;
+	std::atomic<int> inside(0);
+	std::atomic<int> called(0);
+
+	const auto callback = [&inside, &called](int)
+	{
+		inside++;
+		called++;
+		std::this_thread::sleep_for(std::chrono::microseconds(100));
+		inside--;
+	};
+
+	//connection, slot, and connection called by signal copies
+	for (int mode = 0; mode < 3; mode++)
+	{
+		lsignal::slot owner;
+		lsignal::connection conn = sig.connect(callback, &owner);
+		called = 0;
+		thread_executing = true;
+
+		std::vector<std::thread> callers;
+		for (int t = 0; t < 2; t++)
+		{
+			callers.emplace_back([&thread_executing, &sig, mode]()
+			{
+				while (thread_executing)
+				{
+					if (mode == 2)
+					{
+						lsignal::signal<void(int)> copy = sig;
+						copy(0);
+					}
+					else
+						sig(0);
+				}
+			});
+		}
+
+		while (called < 10)
+			std::this_thread::yield();
+
+		if (mode == 1)
+			owner.disconnect_and_wait();
+		else
+			conn.disconnect_and_wait();
+
+		const int inside_after_wait = inside;
+		const int called_after_wait = called;
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		const int called_later = called;
+
+		thread_executing = false;
+		for (std::thread& t : callers)
+			t.join();
+
+		AssertHelper::VerifyValue(0, inside_after_wait, "No call in progress after wait");
+		AssertHelper::VerifyValue(called_after_wait, called_later, "Not called after wait");
+	}
+}
+
+void TestThreadDisconnectAndWaitFromCallback()
+{
+	TestRunner::StartTest(MethodName);
+
+	lsignal::signal<void(int)> sig;
+	std::atomic<bool> inside(false);
+	std::atomic<bool> waiting(false);
+	std::atomic<int> called(0);
+
+	lsignal::connection conn_inner;
+	lsignal::connection conn_outer = sig.connect([&called](int) { called++; }, nullptr);
+
+	//waits for other thread already waiting this call
+	conn_inner = sig.connect([&inside, &waiting, &conn_inner](int)
+	{
+		inside = true;
+		while (!waiting)
+			std::this_thread::yield();
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+		conn_inner.disconnect_and_wait();
+	}, nullptr);
+
+	std::thread caller([&sig]() { sig(0); });
+
+	while (!inside)
+		std::this_thread::yield();
+
+	waiting = true;
+	conn_outer.disconnect_and_wait();
+	caller.join();
+
+	AssertHelper::VerifyValue(1, called.load(), "Called before wait");
+
+	sig(0);
+	AssertHelper::VerifyValue(1, called.load(), "Not called after wait");
+}
+
+void TestThreadReplace()
+{
+	TestRunner::StartTest(MethodName);
+	std::atomic_bool thread_executing(true);
+
+	lsignal::signal<void(int)> sig;
+	std::atomic<int> destroyed_called(0);
+	std::atomic<int> called(0);
+
+	//callable marks itself destroyed, call of destroyed callable is counted
+	struct Callback
+	{
+		std::atomic<int>* called;
+		std::atomic<int>* destroyed_called;
+		bool alive = true;
+
+		Callback(std::atomic<int>* c, std::atomic<int>* d) : called(c), destroyed_called(d) {}
+		Callback(const Callback& rhs) : called(rhs.called), destroyed_called(rhs.destroyed_called) {}
+		~Callback() { alive = false; }
+
+		void operator()(int) const
+		{
+			if (!alive)
+				(*destroyed_called)++;
+			(*called)++;
+		}
+	};
+
+	lsignal::connection conn = sig.connect(Callback(&called, &destroyed_called), nullptr);
+
+	std::vector<std::thread> callers;
+	for (int t = 0; t < 2; t++)
+	{
+		callers.emplace_back([&thread_executing, &sig]()
+		{
+			while (thread_executing)
+				sig(0);
+		});
+	}
+
+	int replaced = 0;
+	for (int i = 0; i < 10000; i++)
+		replaced += sig.replace(conn, Callback(&called, &destroyed_called)) ? 1 : 0;
+
+	thread_executing = false;
+	for (std::thread& t : callers)
+		t.join();
+
+	AssertHelper::VerifyValue(10000, replaced, "Replaced");
+	AssertHelper::VerifyValue(0, destroyed_called.load(), "Destroyed callable not called");
+
+	const int called_before = called;
+	sig(0);
+	AssertHelper::VerifyValue(called_before + 1, called.load(), "Single connection");
+}
+
 void CallMultithreadTests()
 {
 	ExecuteTest(TestThreadAddDeleteCall);
 	ExecuteTest(TestThreadDisconnectConnection);
+	ExecuteTest(TestThreadRealtimeCall);
+	ExecuteTest(TestThreadKeyedCall);
+	ExecuteTest(TestThreadLazyConnect);
+	ExecuteTest(TestThreadDisconnectAndWait);
+	ExecuteTest(TestThreadDisconnectAndWaitFromCallback);
+	ExecuteTest(TestThreadReplace);
 }
@@ -0,0 +1,139 @@
+#include "tests.h"
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+//Profiler is global, every test leaves it disabled and reset.
+static void StopProfiler()
+{
+	lsignal::profiler::set_sampling_period(0);
+	lsignal::profiler::reset();
+}
+
+static uint64_t LabelSamples(const char* label)
+{
+	for (const lsignal::profile_entry& entry : lsignal::profiler::top(SIZE_MAX))
+	{
+		if (entry.label == label)
+			return entry.samples;
+	}
+
+	return 0;
+}
+
+void TestProfilerDisabled()
+{
+	TestRunner::StartTest(MethodName);
+	StopProfiler();
+
+	lsignal::signal<void(int)> sig;
+	int sum = 0;
+	lsignal::connection labeled = sig.connect_labeled("disabled.handler", [&sum](int v) { sum += v; }, nullptr);
+	lsignal::connection plain = sig.connect([&sum](int v) { sum += v; }, nullptr);
+
+	for (int i = 0; i < 100; i++)
+		sig(1);
+
+	AssertHelper::VerifyValue(200, sum, "Called");
+	AssertHelper::VerifyValue(true, std::string(labeled.label()) == "disabled.handler", "Label");
+	AssertHelper::VerifyValue(true, plain.label() == nullptr, "No label");
+	AssertHelper::VerifyValue(true, lsignal::profiler::top(10).empty(), "Nothing sampled");
+}
+
+void TestProfilerSampling()
+{
+	TestRunner::StartTest(MethodName);
+	StopProfiler();
+
+	lsignal::signal<void(int)> sig;
+	lsignal::signal<void(int)> other;
+	int sum = 0;
+	sig.connect_labeled("sampling.a", [&sum](int v) { sum += v; }, nullptr);
+	sig.connect([&sum](int v) { sum += v; }, nullptr);
+	other.connect_labeled("sampling.b", [&sum](int v) { sum += v; }, nullptr);
+	//same label on other signal is summed
+	other.connect_labeled("sampling.a", [&sum](int v) { sum += v; }, nullptr);
+
+	lsignal::profiler::set_sampling_period(4);
+	AssertHelper::VerifyValue(4, (int)lsignal::profiler::sampling_period(), "Period");
+
+	for (int i = 0; i < 100; i++)
+		sig(1);
+	for (int i = 0; i < 100; i++)
+		other(1);
+
+	AssertHelper::VerifyValue(400, sum, "Called");
+	AssertHelper::VerifyValue(50, (int)LabelSamples("sampling.a"), "Every 4th call of signals sampled");
+	AssertHelper::VerifyValue(25, (int)LabelSamples("sampling.b"), "Every 4th call sampled");
+
+	lsignal::profiler::set_sampling_period(1);
+	sig(1);
+	AssertHelper::VerifyValue(51, (int)LabelSamples("sampling.a"), "Every call sampled");
+
+	lsignal::profiler::reset();
+	AssertHelper::VerifyValue(0, (int)LabelSamples("sampling.a"), "Reset");
+	StopProfiler();
+}
+
+void TestProfilerSamplingAlternateSignals()
+{
+	TestRunner::StartTest(MethodName);
+	StopProfiler();
+
+	lsignal::signal<void()> first;
+	lsignal::signal<void()> second;
+	first.connect_labeled("alternate.first", []() {}, nullptr);
+	second.connect_labeled("alternate.second", []() {}, nullptr);
+
+	//countdown of each connection, not of thread, so both are sampled
+	lsignal::profiler::set_sampling_period(2);
+	for (int i = 0; i < 100; i++)
+	{
+		first();
+		second();
+	}
+
+	AssertHelper::VerifyValue(50, (int)LabelSamples("alternate.first"), "First sampled");
+	AssertHelper::VerifyValue(50, (int)LabelSamples("alternate.second"), "Second sampled");
+	StopProfiler();
+}
+
+void TestProfilerTop()
+{
+	TestRunner::StartTest(MethodName);
+	StopProfiler();
+
+	lsignal::signal<void()> sig;
+	sig.connect_labeled("top.fast", []() {}, nullptr);
+	sig.connect_labeled("top.slow", []() { std::this_thread::sleep_for(std::chrono::microseconds(200)); }, nullptr);
+	lsignal::connection replaced = sig.connect_labeled("top.replaced", []() {}, nullptr);
+	sig.replace(replaced, []() { std::this_thread::sleep_for(std::chrono::microseconds(50)); });
+
+	//copy share labels of connections
+	lsignal::signal<void()> copy(sig);
+
+	lsignal::profiler::set_sampling_period(1);
+	for (int i = 0; i < 5; i++)
+	{
+		sig();
+		copy();
+	}
+
+	std::vector<lsignal::profile_entry> top = lsignal::profiler::top(2);
+	AssertHelper::VerifyValue(2, (int)top.size(), "Top count");
+	AssertHelper::VerifyValue(true, top[0].label == "top.slow", "Slowest first");
+	AssertHelper::VerifyValue(true, top[1].label == "top.replaced", "Replaced callable keeps label");
+	AssertHelper::VerifyValue(10, (int)top[0].samples, "Signal and copy sampled");
+	AssertHelper::VerifyValue(true, top[0].nanoseconds >= 10 * 200000, "Time of slow connection");
+	AssertHelper::VerifyValue(3, (int)lsignal::profiler::top(10).size(), "All labels");
+	StopProfiler();
+}
+
+void CallProfilerTests()
+{
+	ExecuteTest(TestProfilerDisabled);
+	ExecuteTest(TestProfilerSampling);
+	ExecuteTest(TestProfilerSamplingAlternateSignals);
+	ExecuteTest(TestProfilerTop);
+}
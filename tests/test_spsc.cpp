@@ -0,0 +1,162 @@
+#include "tests.h"
+#include "../lsignal_spsc.h"
+
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+void TestSpscBridgeOrder()
+{
+	TestRunner::StartTest(MethodName);
+
+	lsignal::signal<void(int, const std::string&)> sig;
+	lsignal::spsc_bridge<void(int, const std::string&)> bridge(sig, 6);
+
+	std::string received;
+	int sum = 0;
+	sig.connect([&received, &sum](int v, const std::string& s) { sum += v; received += s; }, nullptr);
+
+	AssertHelper::VerifyValue(8, (int)bridge.capacity(), "Capacity rounded");
+	AssertHelper::VerifyValue(0, (int)bridge.drain(), "Empty");
+
+	bridge(1, "a");
+	bridge(2, "b");
+	bridge(3, "c");
+	AssertHelper::VerifyValue(3, (int)bridge.pending(), "Pending");
+	AssertHelper::VerifyValue(0, sum, "Not called before drain");
+
+	AssertHelper::VerifyValue(3, (int)bridge.drain(), "Drained");
+	AssertHelper::VerifyValue(6, sum, "Arguments");
+	AssertHelper::VerifyValue(true, received == "abc", "Emit order");
+	AssertHelper::VerifyValue(0, (int)bridge.pending(), "Pending after drain");
+}
+
+void TestSpscBridgeFull()
+{
+	TestRunner::StartTest(MethodName);
+
+	lsignal::signal<void(int)> sig;
+	lsignal::spsc_bridge<void(int)> bridge(sig, 4);
+
+	int last = 0;
+	sig.connect([&last](int v) { last = v; }, nullptr);
+
+	for (int i = 1; i <= 4; i++)
+		AssertHelper::VerifyValue(true, bridge.try_emit(i), "Emit");
+
+	AssertHelper::VerifyValue(false, bridge.try_emit(5), "Ring full");
+	AssertHelper::VerifyValue(2, (int)bridge.drain(2), "Drained up to count");
+	AssertHelper::VerifyValue(2, last, "Drained first");
+
+	AssertHelper::VerifyValue(true, bridge.try_emit(5), "Emit after drain");
+	AssertHelper::VerifyValue(3, (int)bridge.drain(), "Drained rest");
+	AssertHelper::VerifyValue(5, last, "Last value");
+}
+
+void TestSpscBridgeBatchPublish()
+{
+	TestRunner::StartTest(MethodName);
+
+	lsignal::signal<void(int)> sig;
+	lsignal::spsc_bridge<void(int)> bridge(sig, 16, 4);
+
+	int called = 0;
+	sig.connect([&called](int) { called++; }, nullptr);
+
+	for (int i = 0; i < 3; i++)
+		bridge(i);
+
+	AssertHelper::VerifyValue(0, (int)bridge.drain(), "Batch not published");
+
+	bridge(3);
+	AssertHelper::VerifyValue(4, (int)bridge.drain(), "Published by batch");
+
+	bridge(4);
+	bridge.flush();
+	AssertHelper::VerifyValue(1, (int)bridge.drain(), "Published by flush");
+	AssertHelper::VerifyValue(5, called, "Called");
+}
+
+void TestSpscBridgeValuesDestroyed()
+{
+	TestRunner::StartTest(MethodName);
+
+	lsignal::signal<void(std::shared_ptr<int>)> sig;
+	std::shared_ptr<int> value = std::make_shared<int>(7);
+
+	int sum = 0;
+	sig.connect([&sum](std::shared_ptr<int> v) { sum += *v; }, nullptr);
+	sig.connect([](std::shared_ptr<int>) { throw std::runtime_error("callback"); }, nullptr);
+
+	{
+		lsignal::spsc_bridge<void(std::shared_ptr<int>)> bridge(sig, 8, 2);
+		for (int i = 0; i < 5; i++)
+			bridge(value);
+
+		AssertHelper::VerifyValue(6, (int)value.use_count(), "Stored by value");
+
+		bool thrown = false;
+		try
+		{
+			bridge.drain();
+		}
+		catch (const std::runtime_error&)
+		{
+			thrown = true;
+		}
+
+		AssertHelper::VerifyValue(true, thrown, "Exception of callback");
+		AssertHelper::VerifyValue(7, sum, "Called once");
+		AssertHelper::VerifyValue(5, (int)value.use_count(), "Value destroyed after exception");
+	}
+
+	AssertHelper::VerifyValue(1, (int)value.use_count(), "Published and unpublished values destroyed");
+}
+
+void TestSpscBridgeThreads()
+{
+	TestRunner::StartTest(MethodName);
+	const int count = 100000;
+
+	for (lsignal::spsc_wait wait : { lsignal::spsc_wait::spin, lsignal::spsc_wait::block })
+	{
+		for (size_t batch : { 1, 16 })
+		{
+			lsignal::signal<void(int)> sig;
+			int expected = 0;
+			bool ordered = true;
+			sig.connect([&expected, &ordered](int v)
+			{
+				ordered = ordered && v == expected;
+				expected++;
+			}, nullptr);
+
+			lsignal::spsc_bridge<void(int)> bridge(sig, 64, batch, wait, 16);
+			bridge.start();
+
+			std::thread producer([&bridge, count]()
+			{
+				for (int i = 0; i < count; i++)
+					bridge(i);
+				bridge.flush();
+			});
+			producer.join();
+
+			for (int i = 0; i < 5000 && bridge.pending() != 0; i++)
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			bridge.stop();
+
+			AssertHelper::VerifyValue(count, expected, "All received");
+			AssertHelper::VerifyValue(true, ordered, "In order");
+		}
+	}
+}
+
+void CallSpscTests()
+{
+	ExecuteTest(TestSpscBridgeOrder);
+	ExecuteTest(TestSpscBridgeFull);
+	ExecuteTest(TestSpscBridgeBatchPublish);
+	ExecuteTest(TestSpscBridgeValuesDestroyed);
+	ExecuteTest(TestSpscBridgeThreads);
+}
@@ -0,0 +1,419 @@
+#include "tests.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+//Randomized stress of concurrent connect, disconnect, set_lock, slot destruction, signal copy
+//and recursive calls, disconnect_and_wait. Every call takes ticket from global clock before emit, operations take
+//ticket after they returned, so "called after disconnect" is call with ticket greater than
+//disconnect ticket. After disconnect_and_wait callback must not run at all. Use-after-free is found by sanitizers: make tsan, make asan.
+
+namespace
+{
+	using StressSignal = lsignal::signal<void(uint64_t, int, int)>;
+
+	enum StressOp { op_emit, op_connect, op_disconnect, op_wait, op_lock, op_slot, op_copy, op_count };
+	const char* const stress_op_names[op_count] = { "emit", "connect", "disconnect", "wait", "set_lock", "slot", "copy" };
+
+	enum StressError { err_disconnected, err_locked, err_destroyed, err_count_mismatch, err_waited, err_count };
+	const char* const stress_error_names[err_count] = { "called after disconnect", "called after lock",
+		"destroyed callable called", "call count mismatch", "called after disconnect_and_wait" };
+
+	const uint32_t callback_alive = 0x5EED1234;
+	const uint32_t callback_destroyed = 0xDEADDEAD;
+
+	struct StressContext
+	{
+		StressSignal sig;
+		std::atomic<uint64_t> clock{1};
+		std::atomic<uint64_t> emits{0};
+		std::atomic<uint64_t> persistent_calls{0};
+		std::atomic<uint64_t> errors[err_count] = {};
+		std::atomic<bool> executing{true};
+
+		void error(StressError err) { errors[err]++; }
+	};
+
+	//Connection of one worker thread. Shared with callable, in-flight calls can outlive disconnect.
+	struct StressRecord
+	{
+		lsignal::connection connection;
+		int thread = 0;
+		int slot = -1;
+		bool locked = false;
+
+		//ticket taken after disconnect() or set_lock(true) returned, 0 if none
+		std::atomic<uint64_t> disconnected_at{0};
+		std::atomic<uint64_t> locked_at{0};
+		//set after disconnect_and_wait() returned
+		std::atomic<bool> waited{false};
+		std::atomic<int> executing{0};
+
+		//top level calls emitted by owner thread, exact because only owner changes connection
+		std::atomic<uint64_t> own_calls{0};
+		uint64_t own_expected = 0;
+	};
+
+	struct StressCallback
+	{
+		StressContext* context;
+		std::shared_ptr<StressRecord> record;
+		uint32_t magic = callback_alive;
+
+		StressCallback(StressContext* ctx, std::shared_ptr<StressRecord> rec) : context(ctx), record(std::move(rec)) {}
+		StressCallback(const StressCallback& rhs) : context(rhs.context), record(rhs.record) {}
+		~StressCallback() { magic = callback_destroyed; }
+
+		void operator()(uint64_t ticket, int thread, int depth) const
+		{
+			if (magic != callback_alive)
+			{
+				context->error(err_destroyed);
+				return;
+			}
+
+			record->executing++;
+			if (record->waited)
+				context->error(err_waited);
+
+			const uint64_t disconnected_at = record->disconnected_at.load();
+			if (disconnected_at != 0 && disconnected_at < ticket)
+				context->error(err_disconnected);
+
+			const uint64_t locked_at = record->locked_at.load();
+			if (locked_at != 0 && locked_at < ticket)
+				context->error(err_locked);
+
+			if (thread == record->thread && depth == 0)
+				record->own_calls.fetch_add(1, std::memory_order_relaxed);
+
+			record->executing--;
+		}
+	};
+
+	struct StressResult
+	{
+		uint64_t ops[op_count] = {};
+		uint64_t errors[err_count] = {};
+		uint64_t emits = 0;
+		double seconds = 0;
+
+		uint64_t total_ops() const
+		{
+			uint64_t total = 0;
+			for (uint64_t count : ops)
+				total += count;
+			return total;
+		}
+
+		uint64_t total_errors() const
+		{
+			uint64_t total = 0;
+			for (uint64_t count : errors)
+				total += count;
+			return total;
+		}
+	};
+
+	class StressWorker
+	{
+	public:
+		static const int max_records = 64;
+		static const int slot_count = 4;
+
+		StressWorker(StressContext& context, int thread, uint32_t seed) : m_context(context), m_thread(thread), m_random(seed)
+		{
+			for (std::unique_ptr<lsignal::slot>& owner : m_slots)
+				owner.reset(new lsignal::slot());
+		}
+
+		void Run()
+		{
+			while (m_context.executing.load(std::memory_order_relaxed))
+			{
+				const uint32_t roll = m_random() % 100;
+
+				if (roll < 35)
+					Emit();
+				else if (roll < 55)
+					Connect();
+				else if (roll < 70)
+					Disconnect();
+				else if (roll < 75)
+					DisconnectAndWait();
+				else if (roll < 88)
+					ToggleLock();
+				else if (roll < 93)
+					DestroySlot();
+				else
+					CopyAndEmit();
+			}
+
+			for (size_t i = 0; i < m_records.size(); i++)
+				Verify(*m_records[i]);
+		}
+
+		uint64_t ops[op_count] = {};
+
+	private:
+		void Emit()
+		{
+			CountOwnCalls();
+			m_context.emits++;
+			m_context.sig(m_context.clock++, m_thread, 0);
+			ops[op_emit]++;
+		}
+
+		void Connect()
+		{
+			if (m_records.size() >= max_records)
+			{
+				Disconnect();
+				return;
+			}
+
+			std::shared_ptr<StressRecord> record = std::make_shared<StressRecord>();
+			record->thread = m_thread;
+			record->slot = (int)(m_random() % (slot_count + 1)) - 1;
+
+			lsignal::slot* owner = record->slot >= 0 ? m_slots[record->slot].get() : nullptr;
+			record->connection = m_context.sig.connect(StressCallback(&m_context, record), owner);
+
+			m_records.push_back(std::move(record));
+			ops[op_connect]++;
+		}
+
+		void Disconnect()
+		{
+			if (m_records.empty())
+				return;
+
+			const size_t index = m_random() % m_records.size();
+			std::shared_ptr<StressRecord> record = std::move(m_records[index]);
+			m_records[index] = std::move(m_records.back());
+			m_records.pop_back();
+
+			record->connection.disconnect();
+			record->disconnected_at = m_context.clock++;
+			Verify(*record);
+			ops[op_disconnect]++;
+		}
+
+		void DisconnectAndWait()
+		{
+			if (m_records.empty())
+				return;
+
+			const size_t index = m_random() % m_records.size();
+			std::shared_ptr<StressRecord> record = std::move(m_records[index]);
+			m_records[index] = std::move(m_records.back());
+			m_records.pop_back();
+
+			record->connection.disconnect_and_wait();
+			if (record->executing != 0)
+				m_context.error(err_waited);
+
+			record->waited = true;
+			record->disconnected_at = m_context.clock++;
+			Verify(*record);
+			ops[op_wait]++;
+		}
+
+		void ToggleLock()
+		{
+			if (m_records.empty())
+				return;
+
+			StressRecord& record = *m_records[m_random() % m_records.size()];
+			if (record.locked)
+			{
+				record.locked_at = 0;
+				record.connection.set_lock(false);
+			}
+			else
+			{
+				record.connection.set_lock(true);
+				record.locked_at = m_context.clock++;
+			}
+
+			record.locked = !record.locked;
+			ops[op_lock]++;
+		}
+
+		void DestroySlot()
+		{
+			const int index = (int)(m_random() % slot_count);
+			m_slots[index].reset(new lsignal::slot());
+
+			if (m_random() % 2 == 0)
+				m_slots[index]->set_compact_signals(true);
+
+			const uint64_t ticket = m_context.clock++;
+			for (size_t i = 0; i < m_records.size();)
+			{
+				if (m_records[i]->slot != index)
+				{
+					i++;
+					continue;
+				}
+
+				m_records[i]->disconnected_at = ticket;
+				Verify(*m_records[i]);
+				m_records[i] = std::move(m_records.back());
+				m_records.pop_back();
+			}
+
+			ops[op_slot]++;
+		}
+
+		void CopyAndEmit()
+		{
+			//copy has all connections of this thread, no one of them changed until emit
+			StressSignal copy(m_context.sig);
+
+			CountOwnCalls();
+			m_context.emits++;
+			copy(m_context.clock++, m_thread, 0);
+			ops[op_copy]++;
+		}
+
+		void CountOwnCalls()
+		{
+			for (const std::shared_ptr<StressRecord>& record : m_records)
+			{
+				if (!record->locked)
+					record->own_expected++;
+			}
+		}
+
+		void Verify(const StressRecord& record)
+		{
+			if (record.own_calls.load(std::memory_order_relaxed) != record.own_expected)
+				m_context.error(err_count_mismatch);
+		}
+
+		StressContext& m_context;
+		int m_thread;
+		std::mt19937 m_random;
+		std::vector<std::shared_ptr<StressRecord>> m_records;
+		std::unique_ptr<lsignal::slot> m_slots[slot_count];
+	};
+
+	StressResult RunStress(int thread_count, std::chrono::milliseconds duration, uint32_t seed)
+	{
+		StressContext context;
+		const int persistent_count = 3;
+
+		for (int i = 0; i < persistent_count; i++)
+			context.sig.connect([&context](uint64_t, int, int) { context.persistent_calls++; }, nullptr);
+
+		//recursive call of every 16th top level call, emitted from callback of any signal copy
+		context.sig.connect([&context](uint64_t ticket, int thread, int depth)
+		{
+			if (depth == 0 && ticket % 16 == 0)
+			{
+				context.emits++;
+				context.sig(context.clock++, thread, depth + 1);
+			}
+		}, nullptr);
+
+		std::vector<std::unique_ptr<StressWorker>> workers;
+		for (int i = 0; i < thread_count; i++)
+			workers.emplace_back(new StressWorker(context, i, seed + i));
+
+		std::atomic<int> started(0);
+		std::vector<std::thread> threads;
+		for (int i = 0; i < thread_count; i++)
+		{
+			threads.emplace_back([&workers, &started, thread_count, i]()
+			{
+				started++;
+				while (started < thread_count);
+				workers[i]->Run();
+			});
+		}
+
+		while (started < thread_count);
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		std::this_thread::sleep_for(duration);
+		context.executing = false;
+
+		for (std::thread& t : threads)
+			t.join();
+
+		StressResult result;
+		result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		result.emits = context.emits;
+
+		if (context.persistent_calls != result.emits * persistent_count)
+			context.error(err_count_mismatch);
+
+		for (int i = 0; i < err_count; i++)
+			result.errors[i] = context.errors[i];
+
+		for (const std::unique_ptr<StressWorker>& worker : workers)
+		{
+			for (int i = 0; i < op_count; i++)
+				result.ops[i] += worker->ops[i];
+		}
+
+		return result;
+	}
+
+	void PrintStressResult(int thread_count, const StressResult& result)
+	{
+		std::cout << MakeString("  %d threads: %10.0f ops/s,", thread_count, result.total_ops() / result.seconds);
+		for (int i = 0; i < op_count; i++)
+			std::cout << " " << stress_op_names[i] << "=" << result.ops[i];
+		std::cout << " calls=" << result.emits << "\n";
+
+		for (int i = 0; i < err_count; i++)
+		{
+			if (result.errors[i] != 0)
+				std::cout << "    " << stress_error_names[i] << ": " << result.errors[i] << "\n";
+		}
+	}
+}
+
+void TestStressConnectEmitDisconnect()
+{
+	TestRunner::StartTest(MethodName);
+
+	const int thread_count = 4;
+	StressResult result = RunStress(thread_count, std::chrono::milliseconds(300), 2024);
+	PrintStressResult(thread_count, result);
+
+	AssertHelper::VerifyValue(true, result.ops[op_emit] > 0 && result.ops[op_connect] > 0, "Operations executed");
+	AssertHelper::VerifyValue(0, (int)result.total_errors(), "Invariants violated");
+}
+
+void CallStressTests()
+{
+	ExecuteTest(TestStressConnectEmitDisconnect);
+}
+
+//Contention benchmark: lsignal stress [seconds per thread count] [seed]
+int CallStressBenchmark(int argc, char *argv[])
+{
+	const int seconds = argc > 2 ? std::max(1, atoi(argv[2])) : 2;
+	const uint32_t seed = argc > 3 ? (uint32_t)strtoul(argv[3], nullptr, 10) : (uint32_t)std::random_device()();
+	const int max_threads = (int)std::max(4u, std::thread::hardware_concurrency());
+
+	std::cout << "stress seed=" << seed << "\n";
+
+	uint64_t errors = 0;
+	for (int thread_count = 1; thread_count <= max_threads; thread_count *= 2)
+	{
+		StressResult result = RunStress(thread_count, std::chrono::seconds(seconds), seed);
+		PrintStressResult(thread_count, result);
+		errors += result.total_errors();
+	}
+
+	std::cout << (errors == 0 ? "no invariant violations\n" : "(!) invariant violations found\n");
+	return errors == 0 ? 0 : 1;
+}
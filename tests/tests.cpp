@@ -1,5 +1,86 @@
 #include "tests.h"
 
+#include <cstdlib>
+#include <new>
+
+#ifdef _MSC_VER
+#include <malloc.h>
+#endif
+
+//Replace global operator new to check code which should not touch global heap.
+static thread_local size_t heap_allocation_count = 0;
+
+void* operator new(std::size_t size)
+{
+	heap_allocation_count++;
+
+	if (void* p = std::malloc(size == 0 ? 1 : size))
+		return p;
+
+	throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+	heap_allocation_count++;
+
+	size_t align = (size_t)alignment;
+#ifdef _MSC_VER
+	//no std::aligned_alloc in MSVC, memory is freed by _aligned_free
+	if (void* p = _aligned_malloc(size == 0 ? 1 : size, align))
+		return p;
+#else
+	if (void* p = std::aligned_alloc(align, (size + align - 1) / align * align))
+		return p;
+#endif
+
+	throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+	heap_allocation_count++;
+	return std::malloc(size == 0 ? 1 : size);
+}
+
+void operator delete(void* p, const std::nothrow_t&) noexcept
+{
+	std::free(p);
+}
+
+void operator delete(void* p) noexcept
+{
+	std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+	std::free(p);
+}
+
+void operator delete(void* p, std::align_val_t) noexcept
+{
+#ifdef _MSC_VER
+	_aligned_free(p);
+#else
+	std::free(p);
+#endif
+}
+
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept
+{
+#ifdef _MSC_VER
+	_aligned_free(p);
+#else
+	std::free(p);
+#endif
+}
+
+size_t HeapAllocationCount()
+{
+	return heap_allocation_count;
+}
+
 const char* TestRunner::m_testName;
 
 void TestRunner::StartTest(const char *testName)
@@ -56,11 +137,26 @@ void ExecuteTest(std::function<void()> testMethod)
 
 int main(int argc, char *argv[])
 {
-	(void)argc;
-	(void)argv;
+	if (argc > 1 && std::string(argv[1]) == "bench")
+	{
+		CallBenchmarkTests();
+		return 0;
+	}
+
+	if (argc > 1 && std::string(argv[1]) == "stress")
+		return CallStressBenchmark(argc, argv);
 
 	CallBasicTests();
 	CallMultithreadTests();
+	CallCoalescerTests();
+	CallSpscTests();
+	CallDispatcherTests();
+	CallProfilerTests();
+	CallCoroutineTests();
+	CallAllocatorTests();
+	CallIpcTests();
+	CallJournalTests();
+	CallStressTests();
 	//std::cin.get();
 
 	return 0;
@@ -41,7 +41,46 @@ public:
 	static void VerifyValue(bool expected, bool actual, const char *message);
 };
 
+#ifdef LSIGNAL_COROUTINES
+//Coroutine started immediately. Frame is owned by task and destroyed with it.
+class CoTask
+{
+public:
+	struct promise_type
+	{
+		CoTask get_return_object() { return CoTask(std::coroutine_handle<promise_type>::from_promise(*this)); }
+		std::suspend_never initial_suspend() noexcept { return {}; }
+		std::suspend_always final_suspend() noexcept { return {}; }
+		void return_void() {}
+		void unhandled_exception() { std::terminate(); }
+	};
+
+	CoTask(CoTask&& rhs) : m_handle(rhs.m_handle) { rhs.m_handle = nullptr; }
+	~CoTask() { if (m_handle) m_handle.destroy(); }
+
+	bool done() const { return m_handle.done(); }
+private:
+	explicit CoTask(std::coroutine_handle<promise_type> handle) : m_handle(handle) {}
+
+	std::coroutine_handle<promise_type> m_handle;
+};
+#endif
+
+//Count of global operator new calls made by current thread.
+size_t HeapAllocationCount();
+
 void ExecuteTest(std::function<void()> testMethod);
 
 void CallBasicTests();
-void CallMultithreadTests();
\ No newline at end of file
+void CallMultithreadTests();
+void CallCoalescerTests();
+void CallSpscTests();
+void CallDispatcherTests();
+void CallProfilerTests();
+void CallCoroutineTests();
+void CallAllocatorTests();
+void CallIpcTests();
+void CallJournalTests();
+void CallStressTests();
+void CallBenchmarkTests();
+int CallStressBenchmark(int argc, char *argv[]);
\ No newline at end of file